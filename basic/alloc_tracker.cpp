@@ -0,0 +1,245 @@
+#include "alloc_tracker.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>     // malloc(), free()
+#include <malloc.h>     // malloc_usable_size()
+#include <dlfcn.h>      // dladdr()
+#include <cxxabi.h>     // abi::__cxa_demangle()
+
+#ifdef ALLOC_TRACKER
+
+/*
+ * All counters are atomics with constant initialization, they are ready
+ * before any constructor calls operator new.
+ * Nothing here may allocate: operator new would call itself.
+ */
+static std::atomic<long> s_allocs(0);
+static std::atomic<long> s_frees(0);
+static std::atomic<long> s_bytes(0);
+static std::atomic<long> s_liveBytes(0);
+static std::atomic<long> s_peakBytes(0);
+
+// counters at begin()
+static long s_beginAllocs;
+static long s_beginFrees;
+static long s_beginBytes;
+
+/*
+ * Call site table: open addressing on the return address, a full table
+ * counts the rest to the overflow bucket.
+ */
+static const int SITE_BUCKETS = 1024;
+
+struct Site
+{
+    std::atomic<uintptr_t> m_addr;
+    std::atomic<long> m_count;
+    std::atomic<long> m_bytes;
+};
+
+static Site s_sites[SITE_BUCKETS];
+static std::atomic<long> s_overflowCount(0);
+
+static void countSite(uintptr_t addr, size_t size)
+{
+    uintptr_t hash = (addr >> 4) * 0x9E3779B97F4A7C15ULL;
+    unsigned start = static_cast<unsigned>(hash >> 54); // 10 bits, SITE_BUCKETS
+
+    for (int i = 0; i < SITE_BUCKETS; ++i) {
+        Site &site = s_sites[(start + i) % SITE_BUCKETS];
+        uintptr_t cur = site.m_addr.load(std::memory_order_relaxed);
+
+        if (cur == 0) {
+            // claim the empty bucket, or find who took it first
+            if (!site.m_addr.compare_exchange_strong(cur, addr) && cur != addr)
+                continue;
+        } else if (cur != addr) {
+            continue;
+        }
+
+        site.m_count.fetch_add(1, std::memory_order_relaxed);
+        site.m_bytes.fetch_add(static_cast<long>(size), std::memory_order_relaxed);
+        return;
+    }
+    s_overflowCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void* trackedAlloc(size_t size, uintptr_t site)
+{
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        return nullptr;
+
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    s_bytes.fetch_add(static_cast<long>(size), std::memory_order_relaxed);
+
+    long live = s_liveBytes.fetch_add(static_cast<long>(malloc_usable_size(ptr)),
+                                      std::memory_order_relaxed)
+              + static_cast<long>(malloc_usable_size(ptr));
+    long peak = s_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !s_peakBytes.compare_exchange_weak(peak, live))
+        ;
+
+    countSite(site, size);
+    return ptr;
+}
+
+static void trackedFree(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    s_frees.fetch_add(1, std::memory_order_relaxed);
+    s_liveBytes.fetch_sub(static_cast<long>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+    free(ptr);
+}
+
+#define CALL_SITE reinterpret_cast<uintptr_t>(__builtin_return_address(0))
+
+void* operator new(size_t size)
+{
+    void *ptr = trackedAlloc(size, CALL_SITE);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    void *ptr = trackedAlloc(size, CALL_SITE);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size, CALL_SITE);
+}
+
+void* operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAlloc(size, CALL_SITE);
+}
+
+void operator delete(void *ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { trackedFree(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { trackedFree(ptr); }
+
+bool AllocTracker::isEnabled()
+{
+    return true;
+}
+
+void AllocTracker::begin()
+{
+    for (int i = 0; i < SITE_BUCKETS; ++i) {
+        s_sites[i].m_addr.store(0, std::memory_order_relaxed);
+        s_sites[i].m_count.store(0, std::memory_order_relaxed);
+        s_sites[i].m_bytes.store(0, std::memory_order_relaxed);
+    }
+    s_overflowCount.store(0);
+
+    s_beginAllocs = s_allocs.load();
+    s_beginFrees = s_frees.load();
+    s_beginBytes = s_bytes.load();
+    s_peakBytes.store(s_liveBytes.load());
+}
+
+AllocTracker::Stats AllocTracker::current()
+{
+    Stats stats;
+    stats.m_allocs = s_allocs.load() - s_beginAllocs;
+    stats.m_frees = s_frees.load() - s_beginFrees;
+    stats.m_bytes = s_bytes.load() - s_beginBytes;
+    stats.m_liveBytes = s_liveBytes.load();
+    stats.m_peakBytes = s_peakBytes.load();
+    return stats;
+}
+
+struct SiteCount
+{
+    uintptr_t m_addr;
+    long m_count;
+    long m_bytes;
+
+    bool operator<(const SiteCount &s) const { return m_count > s.m_count; }
+};
+
+// "module+0xoffset", the offset is what addr2line expects for a PIE or .so
+static void printSite(std::ostream &out, uintptr_t addr)
+{
+    Dl_info info;
+    // addr is a return address, addr - 1 is still inside the calling function
+    if (dladdr(reinterpret_cast<void*>(addr - 1), &info) && info.dli_fname) {
+        out << info.dli_fname << "+0x" << std::hex
+            << addr - reinterpret_cast<uintptr_t>(info.dli_fbase) << std::dec;
+        if (info.dli_sname) {
+            int status = 0;
+            char *name = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            out << " (" << (status == 0 ? name : info.dli_sname) << ")";
+            free(name);
+        }
+    } else {
+        out << "0x" << std::hex << addr << std::dec;
+    }
+}
+
+void AllocTracker::report(std::ostream &out)
+{
+    // take the numbers before the report allocates anything
+    Stats stats = current();
+
+    // static: a std::vector would show up as a call site itself
+    static SiteCount sites[SITE_BUCKETS];
+    int count = 0;
+    for (int i = 0; i < SITE_BUCKETS; ++i) {
+        SiteCount s;
+        s.m_addr = s_sites[i].m_addr.load();
+        s.m_count = s_sites[i].m_count.load();
+        s.m_bytes = s_sites[i].m_bytes.load();
+        if (s.m_addr && s.m_count)
+            sites[count++] = s;
+    }
+    std::sort(sites, sites + count);
+
+    out << "--- allocations: " << stats.m_allocs << " new, " << stats.m_frees << " delete, "
+        << stats.m_bytes << " bytes, " << stats.m_allocs - stats.m_frees << " alive, "
+        << "peak " << stats.m_peakBytes << " bytes live\n";
+
+    for (int i = 0; i < count && i < TOP_SITES; ++i) {
+        out << "    " << sites[i].m_count << " x, " << sites[i].m_bytes << " bytes at ";
+        printSite(out, sites[i].m_addr);
+        out << "\n";
+    }
+    if (s_overflowCount.load())
+        out << "    " << s_overflowCount.load() << " x at other sites\n";
+}
+
+#else
+
+bool AllocTracker::isEnabled()
+{
+    return false;
+}
+
+void AllocTracker::begin()
+{
+}
+
+AllocTracker::Stats AllocTracker::current()
+{
+    Stats stats = { 0, 0, 0, 0, 0 };
+    return stats;
+}
+
+void AllocTracker::report(std::ostream &)
+{
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _ALLOC_TRACKER_H_
+#define _ALLOC_TRACKER_H_
+
+#include <iostream>
+
+/*
+ * AllocTracker: count heap allocations of each run() section
+ *
+ * Opt-in, build with:
+ *   cmake -DALLOC_TRACKER=ON
+ * Then libglobal replaces the global operator new/delete, and every test
+ * binary linking it prints after each section:
+ *   - allocations, frees and requested bytes
+ *   - objects still alive at the end, and the peak of live bytes
+ *   - the call sites allocating the most(TOP_SITES)
+ *
+ * A call site is the return address of operator new, printed as
+ * "module+offset", resolve it by:
+ *   addr2line -C -f -e <module> <offset>
+ *
+ * NOTE:
+ *   - Build with -DCMAKE_BUILD_TYPE=Release too, otherwise most call sites
+ *     are std::allocator<T>::allocate(), which is not inlined at -O0.
+ *   - Only the plain operator new/new[] are tracked, not the aligned ones.
+ *   - Live bytes are malloc_usable_size(), a bit more than requested.
+ *   - begin() clears the call site table, don't run it while other threads
+ *     are allocating.
+ */
+class AllocTracker
+{
+public:
+    static const int TOP_SITES = 5;
+
+    struct Stats
+    {
+        long m_allocs;
+        long m_frees;
+        long m_bytes;       // requested by operator new
+        long m_liveBytes;
+        long m_peakBytes;
+    };
+
+    // true if built with -DALLOC_TRACKER=ON
+    static bool isEnabled();
+
+    // start a new section: reset the peak and the call sites
+    static void begin();
+
+    // counters since the last begin()
+    static Stats current();
+
+    static void report(std::ostream &out);
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef _ATOMIC_SHARED_PTR_H_
+#define _ATOMIC_SHARED_PTR_H_
+
+#include <assert.h>
+#include <stdint.h>
+#include <atomic>
+#include <type_traits>
+#include "intrusive_ptr.h"
+
+/*
+ * AtomicSharedPtr: publish a shared object to many readers without a lock
+ *
+ * A reader of a published std::shared_ptr must read the pointer and increment
+ * the count of the object in one step, otherwise the writer may drop the last
+ * reference in between. A mutex, or std::atomic_load(&sp) which takes a lock
+ * from a spinlock pool, does it by blocking the writer.
+ *
+ * Split reference count:
+ *   the published pointer and a 16-bit "local" count share one 64-bit word.
+ *     | local count(16) | pointer(48) |
+ *   load():  one fetch_add on the word, which reserves a reference and reads
+ *            the pointer at the same time. The reference is not counted by
+ *            the object yet, it's pending in the local count.
+ *   store()/exchange(): swap the word, then move the pending local count of
+ *            the old pointer into the object's own count.
+ *   So a reader never waits for the writer: load() is lock-free, with an
+ *   occasional CAS loop. Every TRANSFER_AT loads a reader moves the local
+ *   count into the object, so that the 16-bit field never overflows, and
+ *   retries that compare_exchange while other loads change the word.
+ *
+ * While an object is published its count carries an extra BIAS, covering the
+ * pending local references, so a reader releasing one of them decrements the
+ * object's count directly and never sees zero.
+ *
+ * Objects are IntrusivePtr(intrusive_ptr.h) managed, T derives from
+ * RefCounted<AtomicRefCount>, loads return IntrusivePtr<T>.
+ *
+ * NOTE:
+ *   - 64-bit only, user space pointers fit in the low 48 bits (x86-64, arm64)
+ *   - useCount() of a published object includes BIAS
+ */
+template <class T>
+class AtomicSharedPtr
+{
+private:
+    static_assert(sizeof(void*) == 8, "AtomicSharedPtr packs a pointer in 48 bits");
+    static_assert(std::is_base_of<RefCounted<AtomicRefCount>, T>::value,
+                  "T must derive from RefCounted<AtomicRefCount>");
+
+    static const int PTR_BITS = 48;
+    static const uint64_t PTR_MASK = (uint64_t(1) << PTR_BITS) - 1;
+    static const uint64_t ONE_LOCAL = uint64_t(1) << PTR_BITS;
+    static const uint64_t TRANSFER_AT = 1 << 14;
+    static const long BIAS = 1L << 40;
+
+    std::atomic<uint64_t> m_word;
+
+    static T* ptrOf(uint64_t word) { return reinterpret_cast<T*>(word & PTR_MASK); }
+    static long localOf(uint64_t word) { return static_cast<long>(word >> PTR_BITS); }
+
+    static uint64_t pack(T *ptr)
+    {
+        uint64_t word = reinterpret_cast<uint64_t>(ptr);
+        assert((word & ~PTR_MASK) == 0);
+        return word;
+    }
+
+    // take over the caller's reference, plus BIAS for the local references
+    static uint64_t publish(IntrusivePtr<T> &&ptr)
+    {
+        T *raw = ptr.detach();
+        if (raw)
+            raw->addRefs(BIAS - 1);
+        return pack(raw);
+    }
+
+    // the word has been swapped out: count its local references in the object,
+    // drop BIAS and hand the published reference to the caller
+    static IntrusivePtr<T> unpublish(uint64_t word)
+    {
+        T *raw = ptrOf(word);
+        if (raw)
+            raw->addRefs(localOf(word) - (BIAS - 1));
+        return IntrusivePtr<T>(raw, false);
+    }
+
+    // move the local count of seen's pointer into the object before the 16-bit
+    // field overflows. If the pointer has been replaced, the writer did it.
+    void transfer(uint64_t seen)
+    {
+        T *raw = ptrOf(seen);
+        uint64_t cur = m_word.load(std::memory_order_acquire);
+
+        while (ptrOf(cur) == raw && localOf(cur) >= static_cast<long>(TRANSFER_AT)) {
+            long local = localOf(cur);
+
+            // count them first, the object must never look less referenced
+            if (raw)
+                raw->addRefs(local);
+            if (m_word.compare_exchange_weak(cur, pack(raw), std::memory_order_acq_rel))
+                return;
+            // never reaches zero, the caller holds a reference
+            if (raw)
+                raw->addRefs(-local);
+        }
+    }
+
+public:
+    AtomicSharedPtr(IntrusivePtr<T> ptr = IntrusivePtr<T>())
+        : m_word(publish(std::move(ptr)))
+    {
+    }
+
+    ~AtomicSharedPtr()
+    {
+        unpublish(m_word.load(std::memory_order_acquire));
+    }
+
+    AtomicSharedPtr(const AtomicSharedPtr &) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr &) = delete;
+
+    // readers: lock-free, a CAS loop every TRANSFER_AT loads
+    IntrusivePtr<T> load()
+    {
+        uint64_t old = m_word.fetch_add(ONE_LOCAL, std::memory_order_acquire);
+
+        if (localOf(old) + 1 >= static_cast<long>(TRANSFER_AT))
+            transfer(old);
+
+        // the reserved reference is ours now, adopt it
+        return IntrusivePtr<T>(ptrOf(old), false);
+    }
+
+    // writers
+    IntrusivePtr<T> exchange(IntrusivePtr<T> ptr)
+    {
+        uint64_t old = m_word.exchange(publish(std::move(ptr)), std::memory_order_acq_rel);
+        return unpublish(old);
+    }
+
+    void store(IntrusivePtr<T> ptr)
+    {
+        exchange(std::move(ptr));
+    }
+
+    bool isLockFree() const { return m_word.is_lock_free(); }
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "bench.h"
+#include "global.h"
+#include "output_capture.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <errno.h>      // program_invocation_short_name
+#include <stdlib.h>     // getenv(), atoi()
+
+static const int DEFAULT_WARMUP = 2;
+static const int DEFAULT_REPS = 10;
+static const int MAX_REPS = 1000000;    // for the time budget
+
+// swallows everything, to mute the test's own output while timing it
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) { return n; }
+};
+
+static int envInt(const char *name, int def)
+{
+    const char *value = getenv(name);
+    return value && *value ? atoi(value) : def;
+}
+
+// all results of this program, written to LEARNCPP_BENCH_OUT at exit
+class Results
+{
+private:
+    std::vector<Bench::Stats> m_stats;
+
+    static std::string path()
+    {
+        const char *value = getenv("LEARNCPP_BENCH_OUT");
+        std::string p(value ? value : "");
+        std::string::size_type pos = p.find("%p");
+        if (pos != std::string::npos)
+            p.replace(pos, 2, program_invocation_short_name);
+        return p;
+    }
+
+    static bool endsWith(const std::string &s, const std::string &suffix)
+    {
+        return s.size() >= suffix.size()
+            && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    void writeCsv(const std::string &p)
+    {
+        bool empty = !std::ifstream(p.c_str()).good();
+        std::ofstream out(p.c_str(), std::ios::app);
+        if (empty)
+            out << "program,test,reps,min_ns,median_ns,p99_ns,mean_ns,stddev_ns\n";
+        for (size_t i = 0; i < m_stats.size(); ++i) {
+            const Bench::Stats &s = m_stats[i];
+            out << program_invocation_short_name << "," << s.m_test << "," << s.m_reps << ","
+                << s.m_min << "," << s.m_median << "," << s.m_p99 << ","
+                << s.m_mean << "," << s.m_stddev << "\n";
+        }
+    }
+
+    void writeJson(const std::string &p)
+    {
+        std::ofstream out(p.c_str());
+        out << "{\n  \"program\": \"" << program_invocation_short_name << "\",\n"
+            << "  \"results\": [";
+        for (size_t i = 0; i < m_stats.size(); ++i) {
+            const Bench::Stats &s = m_stats[i];
+            out << (i ? ",\n" : "\n")
+                << "    {\"test\": " << s.m_test << ", \"reps\": " << s.m_reps
+                << ", \"min_ns\": " << s.m_min << ", \"median_ns\": " << s.m_median
+                << ", \"p99_ns\": " << s.m_p99 << ", \"mean_ns\": " << s.m_mean
+                << ", \"stddev_ns\": " << s.m_stddev << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+public:
+    ~Results()
+    {
+        std::string p = path();
+        if (p.empty() || m_stats.empty())
+            return;
+
+        if (endsWith(p, ".csv"))
+            writeCsv(p);
+        else
+            writeJson(p);
+    }
+
+    void add(const Bench::Stats &s) { m_stats.push_back(s); }
+};
+
+static Results s_results;
+
+// samples in ns, sorted by it
+static Bench::Stats summarize(int i, std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+
+    double sum = 0;
+    for (size_t k = 0; k < n; ++k)
+        sum += samples[k];
+    double mean = sum / n;
+
+    double var = 0;
+    for (size_t k = 0; k < n; ++k)
+        var += (samples[k] - mean) * (samples[k] - mean);
+
+    Bench::Stats s;
+    s.m_test = i;
+    s.m_reps = static_cast<int>(n);
+    s.m_min = samples[0];
+    s.m_median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    s.m_p99 = samples[static_cast<size_t>(std::ceil(0.99 * n)) - 1];  // nearest rank
+    s.m_mean = mean;
+    s.m_stddev = n > 1 ? std::sqrt(var / (n - 1)) : 0;
+    return s;
+}
+
+bool Bench::isEnabled()
+{
+    static const bool enabled = envInt("LEARNCPP_BENCH", 0) != 0;
+    return enabled;
+}
+
+Bench::Stats Bench::measure(int i, void (*fn)(void), std::ostream &out)
+{
+    typedef std::chrono::steady_clock clock;
+
+    int warmup = envInt("LEARNCPP_BENCH_WARMUP", DEFAULT_WARMUP);
+    int reps = std::max(1, envInt("LEARNCPP_BENCH_REPS", DEFAULT_REPS));
+    int budgetMs = envInt("LEARNCPP_BENCH_TIME_MS", 0);
+
+    // called through a volatile pointer: the compiler can't inline fn and
+    // fold or hoist its work out of the timed loop
+    void (* volatile call)(void) = fn;
+    std::vector<double> samples;
+
+    {
+        NullBuffer null;
+        OutputCapture::Scope mute(&null);
+
+        for (int k = 0; k < warmup; ++k)
+            (*call)();
+
+        clock::time_point budgetEnd = clock::now() + std::chrono::milliseconds(budgetMs);
+        for (int k = 0; budgetMs > 0 ? k < MAX_REPS : k < reps; ++k) {
+            clobberMemory();
+            clock::time_point start = clock::now();
+            (*call)();
+            clobberMemory();
+            clock::time_point end = clock::now();
+
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+            if (budgetMs > 0 && end >= budgetEnd)
+                break;
+        }
+    }
+
+    Stats s = summarize(i, samples);
+    s_results.add(s);
+
+    out << "--- bench: " << s.m_reps << " reps, us: min " << s.m_min / 1000
+        << ", median " << s.m_median / 1000 << ", p99 " << s.m_p99 / 1000
+        << ", mean " << s.m_mean / 1000 << ", stddev " << s.m_stddev / 1000 << "\n";
+    return s;
+}
@@ -0,0 +1,53 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <iostream>
+
+/*
+ * Bench: the benchmark mode of run()
+ *
+ * Every test binary is a benchmark too, without changing its code. Enable it
+ * by environment variables:
+ *   LEARNCPP_BENCH=1           enable, run() times each test function
+ *   LEARNCPP_BENCH_WARMUP=n    untimed runs before measuring(default 2)
+ *   LEARNCPP_BENCH_REPS=n      timed runs(default 10)
+ *   LEARNCPP_BENCH_TIME_MS=ms  or repeat until the time budget is spent
+ *   LEARNCPP_BENCH_OUT=path    write the results to path when the program
+ *                              exits, CSV if it ends with ".csv", JSON
+ *                              otherwise. "%p" is replaced by the program
+ *                              name, e.g. results_%p.json
+ *
+ * e.g.
+ *   LEARNCPP_BENCH=1 LEARNCPP_BENCH_OUT=results.csv ./vector
+ *
+ * After the normal run of a test function, it runs it again with std::cout,
+ * std::cerr and std::clog muted, timed by std::chrono::steady_clock, and
+ * reports min/median/p99/mean/stddev in microseconds.
+ *
+ * NOTE:
+ *   - The CSV file is appended, so all binaries can share one file.
+ *   - printf() output is not muted.
+ *   - Use -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+class Bench
+{
+public:
+    struct Stats
+    {
+        int m_test;
+        int m_reps;
+        double m_min;       // all in ns
+        double m_median;
+        double m_p99;
+        double m_mean;
+        double m_stddev;
+    };
+
+    static bool isEnabled();
+
+    // time fn as configured, print the stats to out and keep them for the
+    // results file
+    static Stats measure(int i, void (*fn)(void), std::ostream &out);
+};
+
+#endif
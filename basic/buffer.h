@@ -0,0 +1,192 @@
+#ifndef _BUFFER_H_
+#define _BUFFER_H_
+
+#include <charconv>     // std::to_chars
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <stdio.h>      // snprintf()
+#include <string.h>     // memcpy(), strlen()
+
+/*
+ * Buffer: bytes formatted in memory, written to a stream at once
+ *
+ *   Buffer buf;
+ *   buf << "value " << 42 << '\n';
+ *   buf.writeTo(std::cout);
+ *
+ * Every operator<< of std::ostream constructs a sentry(locks the stream if
+ * it's shared, checks its state, flushes a tied stream), goes through the
+ * locale's num_put for numbers and through the streambuf virtually.
+ * Buffer just appends: memcpy for strings, std::to_chars for integers,
+ * growing by doubling.
+ *
+ * printAll(out, objects, buf) prints a container of pointers to objects with
+ * a "Buffer& operator<<(Buffer&, const T&)", and writes to out once per
+ * FLUSH_BYTES rather than once per object.
+ *
+ * NOTE:
+ *   - Integers ignore the locale, they are always formatted like the "C"
+ *     locale.
+ *   - Doubles go through snprintf("%g"), std::to_chars of floating point is
+ *     missing in older standard libraries. snprintf() follows the C locale's
+ *     LC_NUMERIC(setlocale()), not the stream's: the decimal point may be a
+ *     comma.
+ */
+class Buffer
+{
+public:
+    static const size_t FLUSH_BYTES = 1 << 20;
+
+private:
+    std::unique_ptr<char[]> m_data;
+    size_t m_size;
+    size_t m_capacity;
+
+    void grow(size_t need)
+    {
+        size_t capacity = m_capacity ? m_capacity * 2 : 256;
+        while (capacity < need)
+            capacity *= 2;
+
+        std::unique_ptr<char[]> data(new char[capacity]);
+        if (m_size)
+            memcpy(data.get(), m_data.get(), m_size);
+        m_data = std::move(data);
+        m_capacity = capacity;
+    }
+
+public:
+    Buffer() : m_size(0), m_capacity(0) { }
+
+    Buffer(const Buffer &) = delete;
+    Buffer& operator=(const Buffer &) = delete;
+
+    // room for n more bytes at the end
+    char* reserve(size_t n)
+    {
+        if (m_size + n > m_capacity)
+            grow(m_size + n);
+        return m_data.get() + m_size;
+    }
+
+    // n bytes written into what reserve() returned
+    void commit(size_t n) { m_size += n; }
+
+    void append(const char *s, size_t n)
+    {
+        memcpy(reserve(n), s, n);
+        m_size += n;
+    }
+
+    void append(char c)
+    {
+        *reserve(1) = c;
+        ++m_size;
+    }
+
+    template <class T>
+    void appendInteger(T value)
+    {
+        static_assert(std::is_integral<T>::value, "not an integer");
+        char *p = reserve(24);  // 20 digits of a 64-bit integer, a sign
+        m_size += std::to_chars(p, p + 24, value).ptr - p;
+    }
+
+    void appendDouble(double value)
+    {
+        char *p = reserve(32);
+        int n = snprintf(p, 32, "%g", value);
+        if (n > 0)
+            m_size += n < 32 ? n : 31;
+    }
+
+    // everything to out by one write(), then empty
+    void writeTo(std::ostream &out)
+    {
+        if (m_size)
+            out.write(m_data.get(), m_size);
+        m_size = 0;
+    }
+
+    void clear() { m_size = 0; }
+    const char* data() const { return m_data.get(); }
+    size_t size() const { return m_size; }
+    std::string str() const { return std::string(m_data.get(), m_size); }
+};
+
+inline Buffer& operator<<(Buffer &buf, const char *s)
+{
+    buf.append(s, strlen(s));
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, const std::string &s)
+{
+    buf.append(s.data(), s.size());
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, char c)
+{
+    buf.append(c);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, int value)
+{
+    buf.appendInteger(value);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, unsigned value)
+{
+    buf.appendInteger(value);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, long value)
+{
+    buf.appendInteger(value);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, unsigned long value)
+{
+    buf.appendInteger(value);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, long long value)
+{
+    buf.appendInteger(value);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, unsigned long long value)
+{
+    buf.appendInteger(value);
+    return buf;
+}
+
+inline Buffer& operator<<(Buffer &buf, double value)
+{
+    buf.appendDouble(value);
+    return buf;
+}
+
+// buf << *p for every p of objects(pointers or smart pointers), written to
+// out every FLUSH_BYTES and at the end
+template <class Container>
+void printAll(std::ostream &out, const Container &objects, Buffer &buf)
+{
+    for (const auto &p : objects) {
+        buf << *p;
+        if (buf.size() >= Buffer::FLUSH_BYTES)
+            buf.writeTo(out);
+    }
+    buf.writeTo(out);
+}
+
+#endif
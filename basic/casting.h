@@ -0,0 +1,108 @@
+#ifndef _CASTING_H_
+#define _CASTING_H_
+
+#include <type_traits>
+#include <assert.h>
+
+/*
+ * isa<T>, cast<T>, dyn_cast<T>: downcasting without C++ RTTI, LLVM style
+ *
+ *   if (Circle *c = dyn_cast<Circle>(shape))   // nullptr if not a Circle
+ *       c->radius();
+ *   if (isa<Rect>(shape))                       // Rect or Square
+ *       cast<Rect>(shape)->width();             // asserts it's a Rect
+ *
+ * dynamic_cast finds the type_info of the object's most derived class and
+ * searches its graph of base classes for the target's type_info, comparing
+ * type_info identities, out of line in the runtime library: the deeper or
+ * wider the hierarchy the longer the search.
+ * Here the base class stores a kind, set by the constructor of the concrete
+ * class, and every class T answers T::classof(const Base*) by comparing it:
+ *
+ *   enum ShapeKind { SK_CIRCLE, SK_RECT, SK_SQUARE, SK_LAST_RECT = SK_SQUARE };
+ *
+ *   static bool classof(const Shape *s)     // Rect and what derives from it
+ *   {
+ *       return s->getKind() >= SK_RECT && s->getKind() <= SK_LAST_RECT;
+ *   }
+ *
+ * Numbering the kinds in the depth-first order of the hierarchy gives every
+ * class a range covering its derived classes, a cast at any depth is one or
+ * two integer comparisons, without a call.
+ *
+ * NOTE:
+ *   - The hierarchy is closed: adding a class means adding its kind to the
+ *     enum, at the right place in the order.
+ *   - Only downcasts compile, From must be a base of To. An upcast needs no
+ *     check, the conversion is implicit.
+ *   - cast<T> asserts in a Debug build and is a static_cast in Release, use it
+ *     only if the type is known, otherwise dyn_cast<T>.
+ *   - No cross casts between siblings of multiple inheritance, dynamic_cast
+ *     can do them.
+ */
+
+template <class To, class From>
+struct IsDowncast
+{
+    static const bool value = std::is_base_of<From, To>::value
+        && !std::is_same<typename std::remove_cv<From>::type, typename std::remove_cv<To>::type>::value;
+};
+
+// From may be const
+template <class To, class From>
+inline bool isa(From *obj)
+{
+    static_assert(IsDowncast<To, From>::value, "isa<To>(From*): To must derive from From");
+    assert(obj && "isa<> on a null pointer");
+    return To::classof(obj);
+}
+
+template <class To, class From>
+inline bool isa(From &obj)
+{
+    return isa<To>(&obj);
+}
+
+// obj must be a To
+template <class To, class From>
+inline To* cast(From *obj)
+{
+    assert(isa<To>(obj) && "cast<> to the wrong type");
+    return static_cast<To*>(obj);
+}
+
+template <class To, class From>
+inline const To* cast(const From *obj)
+{
+    assert(isa<To>(obj) && "cast<> to the wrong type");
+    return static_cast<const To*>(obj);
+}
+
+template <class To, class From>
+inline To& cast(From &obj)
+{
+    assert(isa<To>(obj) && "cast<> to the wrong type");
+    return static_cast<To&>(obj);
+}
+
+template <class To, class From>
+inline const To& cast(const From &obj)
+{
+    assert(isa<To>(obj) && "cast<> to the wrong type");
+    return static_cast<const To&>(obj);
+}
+
+// nullptr if obj is not a To
+template <class To, class From>
+inline To* dyn_cast(From *obj)
+{
+    return isa<To>(obj) ? static_cast<To*>(obj) : nullptr;
+}
+
+template <class To, class From>
+inline const To* dyn_cast(const From *obj)
+{
+    return isa<To>(obj) ? static_cast<const To*>(obj) : nullptr;
+}
+
+#endif
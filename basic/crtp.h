@@ -0,0 +1,74 @@
+#ifndef _CRTP_H_
+#define _CRTP_H_
+
+#include <type_traits>
+
+/*
+ * CRTP(curiously recurring template pattern): static polymorphism
+ *
+ * A base class template takes the derived class as its parameter and calls
+ * its functions through a static_cast, the call is bound at compile time:
+ *
+ *   template <class Derived>
+ *   class Named : public Crtp<Derived>
+ *   {
+ *   public:
+ *       const char* getName() const { return this->self().name(); }
+ *   };
+ *
+ *   class Cat : public Named<Cat>
+ *   {
+ *   public:
+ *       const char* name() const { return "Cat"; }
+ *   };
+ *
+ * Named<Cat>::getName() calls Cat::name() directly: no vptr, no indirect
+ * call, the compiler inlines it like any other function.
+ *
+ * A chain of classes, like virtual_func.cpp Test 1's A <- B <- C <- D, passes
+ * the most derived class up with MostDerived, a function of a derived class
+ * hides the one of its base like an override:
+ *
+ *   template <class Self = void>
+ *   class A : public Named<MostDerived<Self, A<> > > { ... name() ... };
+ *
+ *   template <class Self = void>
+ *   class B : public A<MostDerived<Self, B<> > > { ... name() ... };
+ *
+ *   B<> b;     // Named<B<> >::getName() calls B::name()
+ *
+ * Which one on a hot path:
+ *   CRTP when the concrete type is known where it's called: a template
+ *     function, a container of one type, a policy chosen at compile time.
+ *     Small functions called per element inline and vectorize.
+ *   virtual when the type is only known at run time: a container of mixed
+ *     types, plugins, a stable interface between libraries. The cost is an
+ *     indirect call per object, and no inlining across it; make the virtual
+ *     function do a batch of work rather than one element.
+ *   neither for a closed set of types mixed at run time, std::variant or
+ *     PolyCollection(poly_collection.h) sorts them out once.
+ *
+ * NOTE:
+ *   - Named<A<> > and Named<B<> > are unrelated types, there is no common base
+ *     to keep them in one container; code using them is a template.
+ *   - A function the derived class forgets to provide silently resolves to
+ *     the base's one, or recurses forever if the base forwards to itself.
+ *     Use different names for the interface(getName) and the implementation
+ *     (name).
+ *   - Every instantiation is code of its own, more types mean a larger binary.
+ */
+
+// self(): the derived object
+template <class Derived>
+class Crtp
+{
+protected:
+    Derived& self() { return static_cast<Derived&>(*this); }
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+// Self if a class derives from this one, Default(this one) if it's the last
+template <class Self, class Default>
+using MostDerived = typename std::conditional<std::is_void<Self>::value, Default, Self>::type;
+
+#endif
@@ -0,0 +1,134 @@
+#include "global.h"
+#include "devirt.h"
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937
+#include <vector>
+
+/*
+ * Devirtualization: when a virtual call becomes a direct one
+ *
+ * A virtual call loads the vptr, loads the function from the vtable and
+ * calls it indirectly: it can't be inlined, and a loop around it doesn't
+ * vectorize. The compiler calls directly when only one function can be the
+ * target:
+ *   - the class is final, no class derives from it
+ *   - the function is final in the class called through
+ *   - LTO(cmake -DLTO=ON): the linker sees the whole program, an override
+ *     in a class never instantiated isn't a target
+ *   - a guess: GCC compares the vtable entry with the only override it knows
+ *     and inlines that one, the indirect call is the fallback
+ *
+ * The classes are in devirt.h, the objects come from devirt_objects.cpp, so
+ * the compiler of this file doesn't know their dynamic types. Every test sums
+ * getValue(x) over INPUTS random x, PASSES times, ns per call, the best of
+ * ROUNDS. The x are read from memory the compiler can't see into, otherwise
+ * an inlined getValue() over 0, 1, 2... folds into a formula and the loop
+ * takes no time at all.
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+const int INPUTS = 4096;        // 16KB, stays in L1
+const int PASSES = 2500;        // about 10M calls
+const int ROUNDS = 5;
+
+template <class F>
+double timeCalls(F f)
+{
+    std::vector<int> inputs(INPUTS);
+    std::mt19937 rng(42);
+    for (int &x : inputs)
+        x = static_cast<int>(rng() % 1000);
+
+    double best = 0;
+    for (int r = 0; r < ROUNDS; ++r) {
+        Timer t;
+        long sum = 0;
+        for (int pass = 0; pass < PASSES; ++pass) {
+            for (int i = 0; i < INPUTS; ++i)
+                sum += f(inputs[i]);
+            clobberMemory();    // inputs may have changed, read them again
+        }
+        doNotOptimize(sum);
+        double ns = t.elapsed() * 1e9 / (static_cast<double>(PASSES) * INPUTS);
+        if (r == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+void printBuild(void)
+{
+#ifdef LTO
+    std::cout << "built with LTO\n";
+#else
+    std::cout << "built without LTO, cmake -DLTO=ON to compare\n";
+#endif
+}
+
+/*
+ * === Test 1: through the base class ===
+ *
+ * A& may be an A, B, C, D or E, getValue1() has several possible targets:
+ * always an indirect call, whatever the object is.
+ */
+namespace Test1
+{
+    void fn(void)
+    {
+        printBuild();
+
+        std::unique_ptr<A> b(makeB());
+        std::unique_ptr<A> c(makeC());
+        std::unique_ptr<A> e(makeE());
+        const A &rb = *b;
+        const A &rc = *c;
+        const A &re = *e;
+
+        std::cout << "A& to a B, getValue1(): " << timeCalls([&rb](int x) { return rb.getValue1(x); }) << " ns\n";
+        std::cout << "A& to a C, getValue1(): " << timeCalls([&rc](int x) { return rc.getValue1(x); }) << " ns\n";
+        std::cout << "A& to an E, getValue1(): " << timeCalls([&re](int x) { return re.getValue1(x); }) << " ns\n";
+    }
+}
+
+/*
+ * === Test 2: through the class itself, final or not ===
+ *
+ *   B&, getValue1():      B isn't final, D overrides it: indirect, but direct
+ *                         with LTO, no D is made(devirt.h)
+ *   B&, getValue3():      final in B: direct
+ *   C&, getValue1():      C is final: direct
+ *   sealedCast<C>(A&):    A& checked once to be a C, then direct
+ */
+namespace Test2
+{
+    void fn(void)
+    {
+        printBuild();
+
+        std::unique_ptr<B> b(makeB());
+        std::unique_ptr<C> c(makeC());
+        std::unique_ptr<A> a(makeC());
+        const B &rb = *b;
+        const C &rc = *c;
+        const A &ra = *a;
+
+        std::cout << "B&, getValue1()          : " << timeCalls([&rb](int x) { return rb.getValue1(x); }) << " ns\n";
+        std::cout << "B&, getValue3() final    : " << timeCalls([&rb](int x) { return rb.getValue3(x); }) << " ns\n";
+        std::cout << "C& final, getValue1()    : " << timeCalls([&rc](int x) { return rc.getValue1(x); }) << " ns\n";
+
+        if (typeid(ra) == typeid(C)) {
+            const C &sealed = sealedCast<const C>(ra);
+            std::cout << "sealedCast<C>(A&)        : "
+                      << timeCalls([&sealed](int x) { return sealed.getValue1(x); }) << " ns\n";
+        }
+    }
+}
+
+REGISTER_TEST(1, "virtual calls through the base class");
+REGISTER_TEST(2, "final class, final function and LTO");
+
+int main(int argc, char *argv[])
+{
+    return runTests(argc, argv);
+}
@@ -0,0 +1,86 @@
+#ifndef _DEVIRT_H_
+#define _DEVIRT_H_
+
+#include <type_traits>
+#include <typeinfo>
+#include <assert.h>
+
+/*
+ * The hierarchy of virtual_func.cpp Test 2, with work in the functions, for
+ * devirt.cpp. The objects are made in devirt_objects.cpp, where devirt.cpp
+ * can't see their types.
+ *
+ *   A             getValue1(), getValue3() virtual
+ *   B : A         overrides both, getValue3() final
+ *   C final : B   inherits B's
+ *   D : B         overrides getValue1(), another target through B&
+ *   E : A         overrides getValue1(), another target through A&
+ *
+ * A call through B& of getValue3(), or through C& of anything, has only one
+ * possible target, the compiler calls it directly and can inline it.
+ * getValue1() through B& could be B's or D's: indirect. No D is ever made
+ * though, makeD() isn't called, with LTO the linker sees D's vtable is
+ * unused, B's is the only target left.
+ * Without D, GCC would guess B's anyway: compare the function in the vtable
+ * once and take an inlined path if it's the one guessed(speculative
+ * devirtualization).
+ */
+class A
+{
+public:
+    virtual ~A() { }
+    virtual int getValue1(int x) const { return x + 1; }
+    virtual int getValue3(int x) const { return x + 3; }
+};
+
+class B : public A
+{
+public:
+    virtual int getValue1(int x) const override { return x * 2; }
+    virtual int getValue3(int x) const override final { return x * 3; }
+};
+
+class C final : public B
+{
+};
+
+class D : public B
+{
+public:
+    virtual int getValue1(int x) const override { return x * 4; }
+};
+
+class E : public A
+{
+public:
+    virtual int getValue1(int x) const override { return x - 1; }
+};
+
+// new objects of each class, defined in devirt_objects.cpp
+A* makeA();
+B* makeB();
+C* makeC();
+D* makeD();
+E* makeE();
+
+/*
+ * sealedCast<T>(obj): obj is known to be a T, a final class, every call
+ * through the result is direct
+ *
+ *   if (typeid(a) == typeid(C))
+ *       for (...)
+ *           sum += sealedCast<C>(a).getValue1(i);   // inlined
+ *
+ * Asserts the dynamic type in a Debug build, doesn't compile if T isn't final:
+ * a class derived from T could override, and the call would be wrong.
+ */
+template <class T, class Base>
+T& sealedCast(Base &obj)
+{
+    static_assert(std::is_final<T>::value, "sealedCast<T>: T must be final");
+    static_assert(std::is_base_of<Base, T>::value, "sealedCast<T>: T must derive from Base");
+    assert(typeid(obj) == typeid(T) && "sealedCast<> to the wrong type");
+    return static_cast<T&>(obj);
+}
+
+#endif
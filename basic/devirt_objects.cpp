@@ -0,0 +1,8 @@
+#include "devirt.h"
+
+// out of devirt.cpp: the caller only knows the static types
+A* makeA() { return new A; }
+B* makeB() { return new B; }
+C* makeC() { return new C; }
+D* makeD() { return new D; }
+E* makeE() { return new E; }
@@ -0,0 +1,357 @@
+#ifndef _ECS_H_
+#define _ECS_H_
+
+#include "slot_map.h"   // SlotHandle
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <assert.h>
+#include <stdint.h>
+
+/*
+ * World: an entity-component store, components by type in columns(SoA)
+ *
+ *   struct Name { std::string m_name; };
+ *   struct Hunger { float m_value; float m_rate; };
+ *
+ *   World world;
+ *   Entity cat = world.create(Name{"Mimi"}, Hunger{0, 1});
+ *   world.each<Hunger>([dt](Hunger &h) { h.m_value += h.m_rate * dt; });
+ *
+ * An entity is a handle and nothing else, its data are components, plain
+ * structs without behaviour. Behaviour is a system, a function run over
+ * every entity having some components.
+ *
+ * Entities with the same set of component types share an archetype, which
+ * keeps a std::vector per component type, row i of every column is entity i:
+ *
+ *   archetype {Name, Hunger}:   Name:   | Mimi | Wangwang | ... |
+ *                               Hunger: | 0, 1 | 2, 3     | ... |
+ *
+ * A system over Hunger reads one dense array of Hunger, the names are never
+ * loaded into the cache, there is no vptr and no pointer to follow.
+ *
+ *   - create(components...): a row in the archetype of these types
+ *   - add<T>()/remove<T>(): moves the entity to the archetype with/without T
+ *   - destroy(): the last row of the archetype is moved into the hole
+ *   - get<T>(entity): T*, nullptr if the entity has no T or is destroyed
+ *   - each<Cs...>(f): f(Cs&...) for every entity having all of Cs
+ *   - parallelEach<Cs...>(f, threads): the same, the rows cut into chunks
+ *     of CHUNK, threads take chunks until none is left
+ *
+ * Entity is a SlotHandle(slot_map.h), a destroyed entity's handle is stale.
+ *
+ * NOTE:
+ *   - At most MAX_COMPONENTS component types in a program.
+ *   - create(), add(), remove() and destroy() move rows, pointers from get()
+ *     are invalidated, keep the Entity.
+ *   - No structural change during each() or parallelEach(), and f of
+ *     parallelEach() runs on several threads at once: only touch the
+ *     components it's given.
+ */
+typedef SlotHandle Entity;
+
+class World
+{
+public:
+    static const int MAX_COMPONENTS = 64;
+    static const size_t CHUNK = 16384;      // rows per task of parallelEach()
+
+private:
+    typedef uint64_t Mask;                  // bit n: component id n
+
+    // type-erased column, the hot path casts to Column<T>
+    class ColumnBase
+    {
+    public:
+        virtual ~ColumnBase() { }
+        virtual ColumnBase* makeEmpty() const = 0;
+        virtual void moveRow(size_t row, ColumnBase &to) = 0;    // appended to "to"
+        virtual void swapRemove(size_t row) = 0;
+    };
+
+    template <class T>
+    class Column : public ColumnBase
+    {
+    public:
+        std::vector<T> m_values;
+
+        virtual ColumnBase* makeEmpty() const { return new Column<T>; }
+
+        virtual void moveRow(size_t row, ColumnBase &to)
+        {
+            static_cast<Column<T>&>(to).m_values.push_back(std::move(m_values[row]));
+        }
+
+        virtual void swapRemove(size_t row)
+        {
+            if (row != m_values.size() - 1)
+                m_values[row] = std::move(m_values.back());
+            m_values.pop_back();
+        }
+    };
+
+    struct Archetype
+    {
+        Mask m_mask;
+        std::unique_ptr<ColumnBase> m_columns[MAX_COMPONENTS];  // by component id
+        std::vector<Entity> m_entities;                         // by row
+
+        explicit Archetype(Mask mask) : m_mask(mask) { }
+    };
+
+    struct Record
+    {
+        Archetype *m_archetype;     // nullptr if free
+        uint32_t m_row;
+        uint32_t m_generation;
+    };
+
+    std::vector<std::unique_ptr<Archetype> > m_archetypes;
+    std::unordered_map<Mask, Archetype*> m_byMask;
+    std::vector<Record> m_records;          // by Entity::m_index
+    std::vector<uint32_t> m_free;           // free records
+
+    static int nextComponentId()
+    {
+        static std::atomic<int> s_next(0);
+        int id = s_next++;
+        assert(id < MAX_COMPONENTS && "too many component types");
+        return id;
+    }
+
+    template <class T>
+    static int componentId()
+    {
+        static const int s_id = nextComponentId();
+        return s_id;
+    }
+
+    template <class... Cs>
+    static Mask maskOf()
+    {
+        Mask mask = 0;
+        int expand[] = { 0, (assert(!(mask & (Mask(1) << componentId<Cs>())) && "a type twice"),
+                             mask |= Mask(1) << componentId<Cs>(), 0)... };
+        (void)expand;
+        return mask;
+    }
+
+    template <class T>
+    static std::vector<T>& column(Archetype &a)
+    {
+        return static_cast<Column<T>&>(*a.m_columns[componentId<T>()]).m_values;
+    }
+
+    // the archetype of mask, its columns made by the caller if it's new
+    Archetype* archetype(Mask mask, bool &created)
+    {
+        std::unordered_map<Mask, Archetype*>::iterator it = m_byMask.find(mask);
+        created = it == m_byMask.end();
+        if (!created)
+            return it->second;
+
+        m_archetypes.emplace_back(new Archetype(mask));
+        Archetype *a = m_archetypes.back().get();
+        m_byMask[mask] = a;
+        return a;
+    }
+
+    // remove row, the last row takes its place
+    void removeRow(Archetype &a, uint32_t row)
+    {
+        for (int id = 0; id < MAX_COMPONENTS; ++id) {
+            if (a.m_mask & (Mask(1) << id))
+                a.m_columns[id]->swapRemove(row);
+        }
+        Entity last = a.m_entities.back();
+        a.m_entities[row] = last;
+        a.m_entities.pop_back();
+        if (row < a.m_entities.size())
+            m_records[last.m_index].m_row = row;
+    }
+
+    // move the entity's components shared by both to "to", then its row
+    void migrate(Entity e, Archetype &to)
+    {
+        Record &r = m_records[e.m_index];
+        Archetype &from = *r.m_archetype;
+        for (int id = 0; id < MAX_COMPONENTS; ++id) {
+            if (from.m_mask & to.m_mask & (Mask(1) << id))
+                from.m_columns[id]->moveRow(r.m_row, *to.m_columns[id]);
+        }
+        removeRow(from, r.m_row);
+
+        r.m_archetype = &to;
+        r.m_row = static_cast<uint32_t>(to.m_entities.size());
+        to.m_entities.push_back(e);
+    }
+
+    template <class F, class... Ts>
+    static void eachRow(F &f, size_t begin, size_t end, Ts*... columns)
+    {
+        for (size_t i = begin; i < end; ++i)
+            f(columns[i]...);
+    }
+
+public:
+    World() { }
+
+    World(const World &) = delete;
+    World& operator=(const World &) = delete;
+
+    bool alive(Entity e) const
+    {
+        return e.m_index < m_records.size() && m_records[e.m_index].m_archetype
+            && m_records[e.m_index].m_generation == e.m_generation;
+    }
+
+    template <class... Cs>
+    Entity create(Cs... components)
+    {
+        bool created;
+        Archetype *a = archetype(maskOf<Cs...>(), created);
+        if (created) {
+            int expand[] = { 0, (a->m_columns[componentId<Cs>()].reset(new Column<Cs>), 0)... };
+            (void)expand;
+        }
+        int expand[] = { 0, (column<Cs>(*a).push_back(std::move(components)), 0)... };
+        (void)expand;
+
+        uint32_t index;
+        if (!m_free.empty()) {
+            index = m_free.back();
+            m_free.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_records.size());
+            m_records.push_back(Record{nullptr, 0, 0});
+        }
+        Record &r = m_records[index];
+        r.m_archetype = a;
+        r.m_row = static_cast<uint32_t>(a->m_entities.size());
+
+        Entity e(index, r.m_generation);
+        a->m_entities.push_back(e);
+        return e;
+    }
+
+    void destroy(Entity e)
+    {
+        if (!alive(e))
+            return;
+        Record &r = m_records[e.m_index];
+        removeRow(*r.m_archetype, r.m_row);
+        r.m_archetype = nullptr;
+        ++r.m_generation;
+        m_free.push_back(e.m_index);
+    }
+
+    template <class T>
+    T* get(Entity e)
+    {
+        if (!alive(e))
+            return nullptr;
+        Record &r = m_records[e.m_index];
+        if (!(r.m_archetype->m_mask & (Mask(1) << componentId<T>())))
+            return nullptr;
+        return &column<T>(*r.m_archetype)[r.m_row];
+    }
+
+    // replaces a T the entity already has
+    template <class T>
+    void add(Entity e, T component)
+    {
+        if (T *old = get<T>(e)) {
+            *old = std::move(component);
+            return;
+        }
+        if (!alive(e))
+            return;
+
+        Archetype &from = *m_records[e.m_index].m_archetype;
+        bool created;
+        Archetype *to = archetype(from.m_mask | (Mask(1) << componentId<T>()), created);
+        if (created) {
+            for (int id = 0; id < MAX_COMPONENTS; ++id) {
+                if (from.m_mask & (Mask(1) << id))
+                    to->m_columns[id].reset(from.m_columns[id]->makeEmpty());
+            }
+            to->m_columns[componentId<T>()].reset(new Column<T>);
+        }
+        migrate(e, *to);
+        column<T>(*to).push_back(std::move(component));
+    }
+
+    template <class T>
+    void remove(Entity e)
+    {
+        if (!get<T>(e))
+            return;
+
+        Archetype &from = *m_records[e.m_index].m_archetype;
+        bool created;
+        Archetype *to = archetype(from.m_mask & ~(Mask(1) << componentId<T>()), created);
+        if (created) {
+            for (int id = 0; id < MAX_COMPONENTS; ++id) {
+                if (to->m_mask & (Mask(1) << id))
+                    to->m_columns[id].reset(from.m_columns[id]->makeEmpty());
+            }
+        }
+        migrate(e, *to);
+    }
+
+    template <class... Cs, class F>
+    void each(F f)
+    {
+        Mask need = maskOf<Cs...>();
+        for (const std::unique_ptr<Archetype> &a : m_archetypes) {
+            if ((a->m_mask & need) == need)
+                eachRow(f, 0, a->m_entities.size(), column<Cs>(*a).data()...);
+        }
+    }
+
+    template <class... Cs, class F>
+    void parallelEach(F f, int threads)
+    {
+        struct Task
+        {
+            Archetype *m_archetype;
+            size_t m_begin;
+            size_t m_end;
+        };
+
+        Mask need = maskOf<Cs...>();
+        std::vector<Task> tasks;
+        for (const std::unique_ptr<Archetype> &a : m_archetypes) {
+            if ((a->m_mask & need) != need)
+                continue;
+            size_t rows = a->m_entities.size();
+            for (size_t begin = 0; begin < rows; begin += CHUNK)
+                tasks.push_back(Task{a.get(), begin, std::min(begin + CHUNK, rows)});
+        }
+
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t t = next++; t < tasks.size(); t = next++) {
+                Archetype &a = *tasks[t].m_archetype;
+                eachRow(f, tasks[t].m_begin, tasks[t].m_end, column<Cs>(a).data()...);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads && static_cast<size_t>(i) < tasks.size(); ++i)
+            workers.push_back(std::thread(work));
+        work();
+        for (std::thread &t : workers)
+            t.join();
+    }
+
+    size_t size() const { return m_records.size() - m_free.size(); }
+    size_t archetypes() const { return m_archetypes.size(); }
+};
+
+#endif
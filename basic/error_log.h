@@ -0,0 +1,276 @@
+#ifndef _ERROR_LOG_H_
+#define _ERROR_LOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string.h>     // memcpy(), strlen()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close(), fsync()
+#include <sys/uio.h>    // writev()
+#include <limits.h>     // IOV_MAX
+
+/*
+ * IErrorLog: the interface class of virtual_func.cpp Test 5
+ *
+ * Every function is pure virtual, mySqrt() logs through an IErrorLog& and
+ * doesn't care where the errors go.
+ */
+class IErrorLog
+{
+public:
+    virtual bool openLog(const char *filename) = 0;
+    virtual bool closeLog() = 0;
+
+    virtual bool writeError(const char *errorMessage) = 0;
+
+    virtual ~IErrorLog() {}; // make a virtual destructor in case we delete an IErrorLog pointer, so the proper derived destructor is called
+};
+
+/*
+ * AsyncErrorLog: writeError() never waits for the disk
+ *
+ *   writeError():  copies the message into a slot of a bounded lock-free
+ *                  queue(many producers, one consumer), no lock, no allocation,
+ *                  no system call. A full queue drops the message and counts
+ *                  it, the caller still doesn't wait.
+ *   writer thread: takes up to BATCH messages at once and writes them by one
+ *                  writev(2), fsync(2)s every FSYNC_INTERVAL_MS if the derived
+ *                  class wants it, and sleeps while the queue is empty.
+ *
+ * The queue is Dmitry Vyukov's bounded MPMC queue: every slot has a sequence
+ * number telling whether it's free for the producer of ticket n or filled
+ * for the consumer of ticket n, a producer claims a ticket by a CAS on m_tail.
+ *
+ * Derived classes open the file descriptor, FileErrorLog and ScreenErrorLog.
+ *
+ * NOTE:
+ *   - Messages longer than MAX_MESSAGE are cut.
+ *   - closeLog() writes everything queued before it returns.
+ */
+class AsyncErrorLog : public IErrorLog
+{
+public:
+    static const size_t SLOTS = 8192;           // power of 2
+    static const size_t MAX_MESSAGE = 240;      // with '\n'
+    static const int BATCH = IOV_MAX < 1024 ? IOV_MAX : 1024;
+    static constexpr int FSYNC_INTERVAL_MS = 1000;
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> m_sequence;
+        size_t m_length;
+        char m_text[MAX_MESSAGE];
+    };
+
+    Slot *m_slots;
+    alignas(64) std::atomic<size_t> m_tail;     // producers' next ticket
+    alignas(64) size_t m_head;                  // the writer's next ticket
+    std::atomic<long> m_dropped;
+    std::atomic<long> m_written;
+    std::atomic<bool> m_stop;
+    std::thread m_writer;
+    int m_fd;
+    bool m_sync;                                // fsync() periodically
+
+    // write queued messages by one writev(), returns how many
+    int writeBatch()
+    {
+        struct iovec iov[BATCH];
+        int count = 0;
+
+        while (count < BATCH) {
+            Slot &slot = m_slots[(m_head + count) & (SLOTS - 1)];
+            if (slot.m_sequence.load(std::memory_order_acquire) != m_head + count + 1)
+                break;  // not filled yet
+            iov[count].iov_base = slot.m_text;
+            iov[count].iov_len = slot.m_length;
+            ++count;
+        }
+        if (count == 0)
+            return 0;
+
+        // a short write continues from where it stopped
+        struct iovec *next = iov;
+        int left = count;
+        while (left > 0) {
+            ssize_t n = writev(m_fd, next, left);
+            if (n < 0)
+                break;  // nowhere to report it, drop the batch
+            while (left > 0 && static_cast<size_t>(n) >= next->iov_len) {
+                n -= next->iov_len;
+                ++next;
+                --left;
+            }
+            if (left > 0) {
+                next->iov_base = static_cast<char*>(next->iov_base) + n;
+                next->iov_len -= n;
+            }
+        }
+
+        // free the slots for the producers of the next round
+        for (int i = 0; i < count; ++i) {
+            Slot &slot = m_slots[(m_head + i) & (SLOTS - 1)];
+            slot.m_sequence.store(m_head + i + SLOTS, std::memory_order_release);
+        }
+        m_head += count;
+        m_written.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    void loop()
+    {
+        typedef std::chrono::steady_clock clock;
+        clock::time_point lastSync = clock::now();
+        const std::chrono::milliseconds interval(FSYNC_INTERVAL_MS);
+        bool dirty = false;
+
+        for (;;) {
+            bool stopping = m_stop.load(std::memory_order_acquire);
+            int count = writeBatch();
+            dirty = dirty || count > 0;
+
+            if (m_sync && dirty
+                && clock::now() - lastSync >= interval) {
+                fsync(m_fd);
+                lastSync = clock::now();
+                dirty = false;
+            }
+
+            if (count == 0) {
+                if (stopping)
+                    break;  // the queue was empty after the stop request
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        if (m_sync && dirty)
+            fsync(m_fd);
+    }
+
+protected:
+    // start the writer on fd, sync: fsync() it periodically
+    bool start(int fd, bool sync)
+    {
+        if (fd < 0 || m_writer.joinable())
+            return false;
+
+        m_fd = fd;
+        m_sync = sync;
+        m_stop.store(false);
+        m_writer = std::thread(&AsyncErrorLog::loop, this);
+        return true;
+    }
+
+    // write what is queued and stop the writer, returns the descriptor
+    int stop()
+    {
+        if (!m_writer.joinable())
+            return -1;
+
+        m_stop.store(true, std::memory_order_release);
+        m_writer.join();
+        int fd = m_fd;
+        m_fd = -1;
+        return fd;
+    }
+
+public:
+    AsyncErrorLog()
+        : m_slots(new Slot[SLOTS]), m_tail(0), m_head(0), m_dropped(0), m_written(0),
+          m_stop(false), m_fd(-1), m_sync(false)
+    {
+        for (size_t i = 0; i < SLOTS; ++i)
+            m_slots[i].m_sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // a derived destructor calls closeLog() to close its descriptor, the
+    // writer is stopped here anyway, before the queue it reads goes away
+    virtual ~AsyncErrorLog()
+    {
+        stop();
+        delete [] m_slots;
+    }
+
+    AsyncErrorLog(const AsyncErrorLog &) = delete;
+    AsyncErrorLog& operator=(const AsyncErrorLog &) = delete;
+
+    virtual bool writeError(const char *errorMessage)
+    {
+        size_t ticket = m_tail.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &m_slots[ticket & (SLOTS - 1)];
+            size_t seq = slot->m_sequence.load(std::memory_order_acquire);
+            if (seq == ticket) {
+                // free for this ticket, claim it
+                if (m_tail.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed))
+                    break;
+            } else if (seq < ticket) {
+                // still holding the message of the last round: full
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                ticket = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        size_t length = strlen(errorMessage);
+        if (length > MAX_MESSAGE - 1)
+            length = MAX_MESSAGE - 1;
+        memcpy(slot->m_text, errorMessage, length);
+        slot->m_text[length] = '\n';
+        slot->m_length = length + 1;
+
+        // filled, for the writer at this ticket
+        slot->m_sequence.store(ticket + 1, std::memory_order_release);
+        return true;
+    }
+
+    long dropped() const { return m_dropped.load(); }
+    long written() const { return m_written.load(); }
+};
+
+// appends to a file, fsync()s it periodically
+class FileErrorLog : public AsyncErrorLog
+{
+public:
+    virtual ~FileErrorLog() { closeLog(); }
+
+    virtual bool openLog(const char *filename)
+    {
+        int fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+        if (!start(fd, true)) {
+            close(fd);
+            return false;
+        }
+        return true;
+    }
+
+    virtual bool closeLog()
+    {
+        int fd = stop();
+        return fd >= 0 && close(fd) == 0;
+    }
+};
+
+// writes to stderr(fd 2, not through std::cerr), filename is ignored
+class ScreenErrorLog : public AsyncErrorLog
+{
+public:
+    virtual ~ScreenErrorLog() { closeLog(); }
+
+    virtual bool openLog(const char *)
+    {
+        return start(STDERR_FILENO, false);
+    }
+
+    virtual bool closeLog()
+    {
+        return stop() >= 0;
+    }
+};
+
+#endif
@@ -2,6 +2,10 @@
 #include "math.h"
 #include <exception> // for std::exception
 #include <stdexcept> // for std::runtime_error
+#include <sstream>   // for std::ostringstream
+#include <execinfo.h> // for backtrace(), backtrace_symbols()
+#include <cxxabi.h>  // for abi::__cxa_demangle()
+#include <stdlib.h>  // for free()
 
 /*
  * === Test 1: basic exception: throw, try, catch ===
@@ -574,6 +578,187 @@ namespace Test5
     }
 }
 
+/*
+ * === Test 6: capture a stack trace on throw ===
+ *
+ * Rethrowing by "throw;" (Test 3) keeps the exception object, but once it is
+ * caught at the top, nobody knows where it was thrown at first.
+ *
+ * Capture the call stack in the exception constructor:
+ *   - only save raw return addresses, bounded by MAX_FRAMES(20 words)
+ *   - backtrace() walks the stack with the unwinder(libgcc), works without
+ *     frame pointers. Walking __builtin_frame_address() is cheaper, but needs
+ *     -fno-omit-frame-pointer for the whole program.
+ *   - symbolization(address -> function name) is very slow, so defer it to
+ *     printTrace(), which is called only if the exception is logged.
+ *   - opt-in: capture is disabled by default, enable it by
+ *     TracedException::setCapture(true)
+ *
+ * NOTE:
+ *   backtrace_symbols() finds names in the dynamic symbol table only, so the
+ *   executable is linked with -rdynamic(ENABLE_EXPORTS in CMakeLists.txt).
+ *   static functions are not exported and print as addresses only.
+ */
+namespace Test6
+{
+    class TracedException: public std::runtime_error
+    {
+    public:
+        static const int MAX_FRAMES = 20;
+
+    private:
+        static bool s_capture;
+
+        void *m_frames[MAX_FRAMES];
+        int m_depth;
+
+    public:
+        TracedException(const std::string &error)
+            : std::runtime_error(error), m_depth(0)
+        {
+            if (s_capture)
+                m_depth = backtrace(m_frames, MAX_FRAMES);
+        }
+
+        static void setCapture(bool enable) { s_capture = enable; }
+
+        int getDepth() const { return m_depth; }
+
+        // slow path, symbolize the saved addresses here
+        void printTrace(std::ostream &out) const
+        {
+            if (m_depth == 0) {
+                out << "  (no stack trace captured)\n";
+                return;
+            }
+
+            char **symbols = backtrace_symbols(m_frames, m_depth);
+            if (!symbols)
+                return;
+
+            // skip frame 0, which is the constructor itself
+            for (int i = 1; i < m_depth; ++i)
+                out << "  #" << i << " " << demangle(symbols[i]) << "\n";
+
+            free(symbols);
+        }
+
+    private:
+        // "./exception(_ZN5Test64lastEv+0x2a) [0x5566...]" -> "Test6::last()+0x2a"
+        static std::string demangle(const char *symbol)
+        {
+            std::string line(symbol);
+            std::string::size_type begin = line.find('(');
+            std::string::size_type end = line.find('+', begin);
+            if (begin == std::string::npos || end == std::string::npos || end == begin + 1)
+                return line;
+
+            std::string mangled = line.substr(begin + 1, end - begin - 1);
+            int status = 0;
+            char *name = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+            std::string offset = line.substr(end, line.find(')', end) - end);
+            if (status != 0)
+                return mangled + offset; // C function, e.g. main
+
+            std::string result = name + offset;
+            free(name);
+            return result;
+        }
+    };
+
+    bool TracedException::s_capture = false;
+
+    void last()
+    {
+        throw TracedException("last() failed");
+    }
+
+    void third()
+    {
+        last();
+    }
+
+    void second()
+    {
+        try
+        {
+            third();
+        }
+        catch (TracedException &e)
+        {
+            std::cout << "second caught \"" << e.what() << "\", rethrow it\n";
+            throw; // the origin site is still in the exception
+        }
+    }
+
+    void ex_trace_rethrow(void)
+    {
+        TracedException::setCapture(true);
+        try
+        {
+            second();
+        }
+        catch (TracedException &e)
+        {
+            std::cout << "main caught \"" << e.what() << "\", thrown at:\n";
+            e.printTrace(std::cout);
+        }
+        TracedException::setCapture(false);
+    }
+
+    // NOTE: noinline, otherwise the throw/catch loop may be folded into one frame
+    __attribute__((noinline)) void throwOne()
+    {
+        throw TracedException("bench");
+    }
+
+    double benchThrow(int count, bool capture, bool symbolize)
+    {
+        TracedException::setCapture(capture);
+        std::ostringstream sink;
+
+        Timer t;
+        for (int i = 0; i < count; ++i) {
+            try
+            {
+                throwOne();
+            }
+            catch (TracedException &e)
+            {
+                if (symbolize)
+                    e.printTrace(sink);
+            }
+        }
+        double ns = t.elapsed() * 1e9 / count;
+
+        TracedException::setCapture(false);
+        return ns;
+    }
+
+    void ex_trace_overhead(void)
+    {
+        const int count = 100000;
+
+        double off = benchThrow(count, false, false);
+        double on = benchThrow(count, true, false);
+        double logged = benchThrow(count / 10, true, true);
+
+        std::cout << "throw + catch, capture off:      " << off << " ns\n";
+        std::cout << "throw + catch, capture on:       " << on << " ns"
+                  << " (+" << on - off << " ns)\n";
+        std::cout << "throw + catch + symbolize:       " << logged << " ns\n";
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< stack trace of a rethrown exception >>>\n";
+        ex_trace_rethrow();
+
+        std::cout << "\n<<< overhead per throw >>>\n";
+        ex_trace_overhead();
+    }
+}
+
 // NOTE: Downside of exceptions
 //   1) in try block, print error message and DO clean up, like freeing resouces.
 //      e.g. delete pointer(or using smart pointer), close fd
@@ -589,11 +774,14 @@ namespace Test5
 //      - The error is *serious* and execution could not continue otherwise
 //      - The error *cannot be handled* at the place where it occurs.
 //      - There *isn’t* a good alternative way to return an *error code back* to the caller.
-int main()
+REGISTER_TEST(1, "basic exception: throw, try, catch");
+REGISTER_TEST(2, "unwind stack");
+REGISTER_TEST(3, "rethrow an exception");
+REGISTER_TEST(4, "exception class");
+REGISTER_TEST(5, "function try block");
+REGISTER_TEST(6, "stack trace on throw");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // basic exception: throw, try, catch
-    run(2, &(Test2::fn)); // unwind stack
-    run(3, &(Test3::fn)); // rethrow an exception
-    run(4, &(Test4::fn)); // exception class
-    run(5, &(Test5::fn)); // function try block
+    return runTests(argc, argv);
 }
@@ -1,8 +1,28 @@
 #include "global.h"
+#include "alloc_tracker.h"
+#include "bench.h"
+#include "perf_counters.h"
+#include "mem_usage.h"
+#include "trace.h"
+#include "logger.h"
 
 void run(int i, void (*fn)(void))
 {
     std::cout << "=== Test " << i << ": begin ===\n\n";
-    (*fn)();
+    AllocTracker::begin();
+    MemUsage::begin();
+    PerfCounters::begin();
+    {
+        TraceSpan span("Test", i);
+        (*fn)();
+        Logger::flush();
+    }
+    PerfCounters::end();
+    MemUsage::end();
+    AllocTracker::report(std::cout);
+    PerfCounters::report(std::cout);
+    MemUsage::report(std::cout);
+    if (Bench::isEnabled())
+        Bench::measure(i, fn, std::cout);
     std::cout << "\n=== Test " << i << ": end ===\n\n";
 }
@@ -5,7 +5,58 @@
 #include <assert.h>
 #include <string>
 #include <vector>
+#include <chrono>
+#include "test_runner.h"
 
 void run(int i, void (*fn)(void));
 
+/*
+ * Timer: measure the elapsed time of a piece of code
+ *
+ *   Timer t;
+ *   doSomething();
+ *   std::cout << t.elapsed() << " seconds\n";
+ *
+ * std::chrono::steady_clock is monotonic, it never goes back when the system
+ * time is adjusted.
+ */
+class Timer
+{
+private:
+    using clock_t = std::chrono::steady_clock;
+    using second_t = std::chrono::duration<double, std::ratio<1> >;
+
+    std::chrono::time_point<clock_t> m_beg;
+
+public:
+    Timer() : m_beg(clock_t::now()) { }
+
+    void reset() { m_beg = clock_t::now(); }
+
+    // in seconds
+    double elapsed() const
+    {
+        return std::chrono::duration_cast<second_t>(clock_t::now() - m_beg).count();
+    }
+};
+
+/*
+ * doNotOptimize: keep a value the benchmark computes, otherwise the compiler
+ * may drop the code computing it, e.g. a copy and destruction of a pointer
+ * is a no-op for the optimizer.
+ * It costs nothing at runtime, the empty asm statement "uses" the value and
+ * clobbers memory(GCC/Clang only).
+ */
+template <class T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// all memory writes before it are done, and nothing is moved across it
+inline void clobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
+
 #endif
@@ -227,9 +227,11 @@ namespace Test3
     }
 }
 
-int main()
+REGISTER_TEST(1, "inheritance order");
+REGISTER_TEST(2, "accesor specifiers, compiling only");
+REGISTER_TEST(3, "inheritance function overiding and hiding");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // inheritance order
-    run(2, &(Test2::fn)); // accesor specifiers, compiling only
-    run(3, &(Test3::fn)); // inheritance function overiding and hiding
+    return runTests(argc, argv);
 }
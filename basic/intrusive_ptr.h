@@ -0,0 +1,165 @@
+#ifndef _INTRUSIVE_PTR_H_
+#define _INTRUSIVE_PTR_H_
+
+#include <atomic>
+#include <utility>
+
+/*
+ * IntrusivePtr: a shared pointer keeping the reference count in the object
+ *
+ * std::shared_ptr<T>(new T) allocates a separate control block for the count,
+ * and every copy updates a cache line other than the object's one.
+ * Here the object derives from RefCounted and carries the count itself:
+ *   - one allocation per object, no control block
+ *   - sizeof(IntrusivePtr<T>) == sizeof(T*)
+ *   - a raw T* can be turned back into an IntrusivePtr at any time
+ *
+ * The counter is a policy:
+ *   AtomicRefCount: safe to share the object across threads
+ *   PlainRefCount:  plain integer, for single-threaded objects only
+ *
+ * e.g.
+ *   class Resource : public RefCounted<PlainRefCount> { ... };
+ *   IntrusivePtr<Resource> p = makeIntrusive<Resource>();
+ *
+ * NOTE:
+ *   IntrusivePtr deletes the object through T*, so an IntrusivePtr<Base>
+ *   pointing to a Derived needs a virtual destructor in Base.
+ *   No weak pointer support, use std::shared_ptr if cycles are expected.
+ */
+
+class AtomicRefCount
+{
+private:
+    std::atomic<long> m_count;
+
+public:
+    AtomicRefCount() : m_count(0) { }
+
+    // nobody waits for the increment, relaxed is enough
+    void increment() { m_count.fetch_add(1, std::memory_order_relaxed); }
+
+    // returns true when the last reference is gone
+    // acq_rel: all writes to the object happen before its destruction
+    bool decrement() { return m_count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    // add n(may be negative) references at once, returns the new count
+    long add(long n) { return m_count.fetch_add(n, std::memory_order_acq_rel) + n; }
+
+    long get() const { return m_count.load(std::memory_order_relaxed); }
+};
+
+class PlainRefCount
+{
+private:
+    long m_count;
+
+public:
+    PlainRefCount() : m_count(0) { }
+
+    void increment() { ++m_count; }
+    bool decrement() { return --m_count == 0; }
+    long add(long n) { return m_count += n; }
+    long get() const { return m_count; }
+};
+
+template <class Counter = AtomicRefCount>
+class RefCounted
+{
+private:
+    mutable Counter m_refs;
+
+protected:
+    RefCounted() { }
+    ~RefCounted() { }
+
+    // a copied object is a new object, it starts without references
+    RefCounted(const RefCounted &) { }
+    RefCounted& operator=(const RefCounted &) { return *this; }
+
+public:
+    void addRef() const { m_refs.increment(); }
+
+    // returns true if the caller dropped the last reference
+    bool release() const { return m_refs.decrement(); }
+
+    // batch update for AtomicSharedPtr, returns the new count
+    long addRefs(long n) const { return m_refs.add(n); }
+
+    long useCount() const { return m_refs.get(); }
+};
+
+template <class T>
+class IntrusivePtr
+{
+private:
+    T *m_ptr;
+
+public:
+    // addRef=false adopts a reference the caller already owns, see detach()
+    IntrusivePtr(T *ptr = nullptr, bool addRef = true)
+        : m_ptr(ptr)
+    {
+        if (m_ptr && addRef)
+            m_ptr->addRef();
+    }
+
+    ~IntrusivePtr()
+    {
+        if (m_ptr && m_ptr->release())
+            delete m_ptr;
+    }
+
+    IntrusivePtr(const IntrusivePtr &p)
+        : m_ptr(p.m_ptr)
+    {
+        if (m_ptr)
+            m_ptr->addRef();
+    }
+
+    IntrusivePtr(IntrusivePtr &&p) noexcept
+        : m_ptr(p.m_ptr)
+    {
+        p.m_ptr = nullptr;
+    }
+
+    // copy-and-swap, handles self-assignment and releases the old object
+    IntrusivePtr& operator=(const IntrusivePtr &p)
+    {
+        IntrusivePtr(p).swap(*this);
+        return *this;
+    }
+
+    IntrusivePtr& operator=(IntrusivePtr &&p) noexcept
+    {
+        IntrusivePtr(std::move(p)).swap(*this);
+        return *this;
+    }
+
+    void reset(T *ptr = nullptr) { IntrusivePtr(ptr).swap(*this); }
+
+    void swap(IntrusivePtr &p) noexcept { std::swap(m_ptr, p.m_ptr); }
+
+    // give up the ownership without releasing the reference
+    T* detach()
+    {
+        T *ptr = m_ptr;
+        m_ptr = nullptr;
+        return ptr;
+    }
+
+    T* get() const { return m_ptr; }
+    T& operator*() const { return *m_ptr; }
+    T* operator->() const { return m_ptr; }
+    explicit operator bool() const { return m_ptr != nullptr; }
+
+    long useCount() const { return m_ptr ? m_ptr->useCount() : 0; }
+};
+
+template <class T, class... Args>
+IntrusivePtr<T> makeIntrusive(Args&&... args)
+{
+    return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+#endif
@@ -56,7 +56,9 @@ namespace Test1
     }
 }
 
-int main()
+REGISTER_TEST(1, "lambda capture");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // lambda capture
+    return runTests(argc, argv);
 }
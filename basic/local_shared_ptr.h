@@ -0,0 +1,293 @@
+#ifndef _LOCAL_SHARED_PTR_H_
+#define _LOCAL_SHARED_PTR_H_
+
+#include <assert.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#ifdef DEBUG
+#include <thread>
+#endif
+
+/*
+ * local_shared_ptr and local_weak_ptr: std::shared_ptr/std::weak_ptr for
+ * objects that never leave their thread
+ *
+ * std::shared_ptr counts with atomic instructions, since any copy may be made
+ * by another thread. An object graph owned by a single thread pays for that
+ * on every copy, destruction and weak_ptr::lock().
+ * These are the same pointers counting with plain longs:
+ *   local_shared_ptr: get(), *, ->, bool, reset(), use_count()
+ *   local_weak_ptr:   lock(), expired(), reset(), use_count()
+ *   make_local_shared<T>(args): one allocation for the object and the counts
+ *
+ * NOTE:
+ *   Sharing them across threads is a data race on the counts. The Debug
+ *   build(-DDEBUG) records the thread creating the control block and asserts
+ *   that every count update happens in that thread.
+ *   No aliasing constructor, custom deleter or enable_shared_from_this.
+ */
+
+class LocalControlBlock
+{
+private:
+    long m_shared;
+    long m_weak;        // +1 while m_shared > 0, like std::shared_ptr
+#ifdef DEBUG
+    std::thread::id m_owner;
+#endif
+
+    // destroy the managed object, the block itself may still be alive
+    virtual void dispose() = 0;
+
+public:
+    LocalControlBlock()
+        : m_shared(1), m_weak(1)
+#ifdef DEBUG
+        , m_owner(std::this_thread::get_id())
+#endif
+    {
+    }
+
+    virtual ~LocalControlBlock() { }
+
+    void checkThread() const
+    {
+#ifdef DEBUG
+        assert(m_owner == std::this_thread::get_id() &&
+               "local_shared_ptr is shared across threads");
+#endif
+    }
+
+    long sharedCount() const { return m_shared; }
+
+    void addShared() { checkThread(); ++m_shared; }
+    void addWeak() { checkThread(); ++m_weak; }
+
+    // lock(): take a shared reference only if the object is still alive
+    bool tryAddShared()
+    {
+        checkThread();
+        if (m_shared == 0)
+            return false;
+        ++m_shared;
+        return true;
+    }
+
+    void releaseShared()
+    {
+        checkThread();
+        if (--m_shared == 0) {
+            // the object may hold a local_weak_ptr to itself, the implicit
+            // weak reference keeps the block alive while it's destroyed
+            dispose();
+            releaseWeak();
+        }
+    }
+
+    void releaseWeak()
+    {
+        checkThread();
+        if (--m_weak == 0)
+            delete this;
+    }
+};
+
+// local_shared_ptr<T>(new T): the object is allocated by the caller
+template <class T>
+class LocalPointerBlock : public LocalControlBlock
+{
+private:
+    T *m_ptr;
+
+    virtual void dispose() { delete m_ptr; }
+
+public:
+    LocalPointerBlock(T *ptr) : m_ptr(ptr) { }
+};
+
+// make_local_shared<T>(): the object lives inside the block
+template <class T>
+class LocalInplaceBlock : public LocalControlBlock
+{
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+
+    virtual void dispose() { get()->~T(); }
+
+public:
+    template <class... Args>
+    LocalInplaceBlock(Args&&... args)
+    {
+        new (&m_storage) T(std::forward<Args>(args)...);
+    }
+
+    T* get() { return reinterpret_cast<T*>(&m_storage); }
+};
+
+template <class T>
+class local_weak_ptr;
+
+template <class T>
+class local_shared_ptr
+{
+private:
+    T *m_ptr;
+    LocalControlBlock *m_block;
+
+    // adopt a reference already counted in block
+    local_shared_ptr(T *ptr, LocalControlBlock *block)
+        : m_ptr(ptr), m_block(block)
+    {
+    }
+
+    template <class U> friend class local_weak_ptr;
+    template <class U, class... Args>
+    friend local_shared_ptr<U> make_local_shared(Args&&... args);
+
+public:
+    local_shared_ptr()
+        : m_ptr(nullptr), m_block(nullptr)
+    {
+    }
+
+    explicit local_shared_ptr(T *ptr)
+        : m_ptr(ptr), m_block(ptr ? new LocalPointerBlock<T>(ptr) : nullptr)
+    {
+    }
+
+    ~local_shared_ptr()
+    {
+        if (m_block)
+            m_block->releaseShared();
+    }
+
+    local_shared_ptr(const local_shared_ptr &p)
+        : m_ptr(p.m_ptr), m_block(p.m_block)
+    {
+        if (m_block)
+            m_block->addShared();
+    }
+
+    local_shared_ptr(local_shared_ptr &&p) noexcept
+        : m_ptr(p.m_ptr), m_block(p.m_block)
+    {
+        p.m_ptr = nullptr;
+        p.m_block = nullptr;
+    }
+
+    local_shared_ptr& operator=(const local_shared_ptr &p)
+    {
+        local_shared_ptr(p).swap(*this);
+        return *this;
+    }
+
+    local_shared_ptr& operator=(local_shared_ptr &&p) noexcept
+    {
+        local_shared_ptr(std::move(p)).swap(*this);
+        return *this;
+    }
+
+    void reset() { local_shared_ptr().swap(*this); }
+    void reset(T *ptr) { local_shared_ptr(ptr).swap(*this); }
+
+    void swap(local_shared_ptr &p) noexcept
+    {
+        std::swap(m_ptr, p.m_ptr);
+        std::swap(m_block, p.m_block);
+    }
+
+    T* get() const { return m_ptr; }
+    T& operator*() const { return *m_ptr; }
+    T* operator->() const { return m_ptr; }
+    explicit operator bool() const { return m_ptr != nullptr; }
+
+    long use_count() const { return m_block ? m_block->sharedCount() : 0; }
+};
+
+template <class T, class... Args>
+local_shared_ptr<T> make_local_shared(Args&&... args)
+{
+    LocalInplaceBlock<T> *block = new LocalInplaceBlock<T>(std::forward<Args>(args)...);
+    return local_shared_ptr<T>(block->get(), block);
+}
+
+template <class T>
+class local_weak_ptr
+{
+private:
+    T *m_ptr;
+    LocalControlBlock *m_block;
+
+public:
+    local_weak_ptr()
+        : m_ptr(nullptr), m_block(nullptr)
+    {
+    }
+
+    local_weak_ptr(const local_shared_ptr<T> &p)
+        : m_ptr(p.m_ptr), m_block(p.m_block)
+    {
+        if (m_block)
+            m_block->addWeak();
+    }
+
+    ~local_weak_ptr()
+    {
+        if (m_block)
+            m_block->releaseWeak();
+    }
+
+    local_weak_ptr(const local_weak_ptr &p)
+        : m_ptr(p.m_ptr), m_block(p.m_block)
+    {
+        if (m_block)
+            m_block->addWeak();
+    }
+
+    local_weak_ptr(local_weak_ptr &&p) noexcept
+        : m_ptr(p.m_ptr), m_block(p.m_block)
+    {
+        p.m_ptr = nullptr;
+        p.m_block = nullptr;
+    }
+
+    local_weak_ptr& operator=(const local_weak_ptr &p)
+    {
+        local_weak_ptr(p).swap(*this);
+        return *this;
+    }
+
+    local_weak_ptr& operator=(local_weak_ptr &&p) noexcept
+    {
+        local_weak_ptr(std::move(p)).swap(*this);
+        return *this;
+    }
+
+    local_weak_ptr& operator=(const local_shared_ptr<T> &p)
+    {
+        local_weak_ptr(p).swap(*this);
+        return *this;
+    }
+
+    void reset() { local_weak_ptr().swap(*this); }
+
+    void swap(local_weak_ptr &p) noexcept
+    {
+        std::swap(m_ptr, p.m_ptr);
+        std::swap(m_block, p.m_block);
+    }
+
+    long use_count() const { return m_block ? m_block->sharedCount() : 0; }
+    bool expired() const { return use_count() == 0; }
+
+    // returns an empty local_shared_ptr if the object is gone
+    local_shared_ptr<T> lock() const
+    {
+        if (m_block && m_block->tryAddShared())
+            return local_shared_ptr<T>(m_ptr, m_block);
+        return local_shared_ptr<T>();
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "global.h"
+#include "logger.h"
+#include <algorithm>    // std::sort
+#include <thread>       // std::thread
+#include <stdio.h>      // printf(), fflush()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // dup(), dup2(), close()
+
+/*
+ * Latency added to the calling thread by logging a line
+ *
+ *   std::cout + endl: formats, locks the stream, write(2) every line
+ *   printf:           formats, locks stdout, buffered
+ *   LOG_INFO:         copies the arguments into the thread's ring(logger.h)
+ *
+ * Each call is timed on its own, the lines go to /dev/null. The lines are
+ * logged in bursts of BURST, half a logger ring, then everything is flushed
+ * untimed: a burst longer than the ring runs at the writer's speed, whatever
+ * the caller does.
+ *
+ * Reports percentiles of ns per call, including ~20 ns of the two clock reads.
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+const int MESSAGES = 100000;
+const int BURST = static_cast<int>(Logger::RING_SIZE / 2);
+
+enum Method
+{
+    METHOD_COUT,
+    METHOD_PRINTF,
+    METHOD_LOGGER,
+};
+
+// stdout and std::cout(synced with stdio) go to /dev/null in the scope
+class DiscardStdout
+{
+private:
+    int m_saved;
+
+public:
+    DiscardStdout()
+    {
+        std::cout.flush();
+        fflush(stdout);
+        m_saved = dup(1);
+        int fd = open("/dev/null", O_WRONLY);
+        dup2(fd, 1);
+        close(fd);
+    }
+
+    ~DiscardStdout()
+    {
+        std::cout.flush();
+        fflush(stdout);
+        dup2(m_saved, 1);
+        close(m_saved);
+    }
+};
+
+void flushAll(Method method)
+{
+    if (method == METHOD_LOGGER)
+        Logger::flush();
+    else if (method == METHOD_COUT)
+        std::cout.flush();
+    else
+        fflush(stdout);
+}
+
+// log MESSAGES lines, returns ns of each call
+std::vector<int64_t> logLines(Method method)
+{
+    typedef std::chrono::steady_clock clock;
+    std::vector<int64_t> samples;
+    samples.reserve(MESSAGES);
+
+    for (int i = 0; i < MESSAGES; ++i) {
+        clock::time_point start = clock::now();
+        switch (method) {
+        case METHOD_COUT:
+            std::cout << "value " << i << " of " << MESSAGES << std::endl;
+            break;
+        case METHOD_PRINTF:
+            printf("value %d of %d\n", i, MESSAGES);
+            break;
+        case METHOD_LOGGER:
+            LOG_INFO("value ", i, " of ", MESSAGES);
+            break;
+        }
+        clock::time_point end = clock::now();
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+        if (i % BURST == BURST - 1)
+            flushAll(method);
+    }
+    flushAll(method);
+    return samples;
+}
+
+void report(const char *name, std::vector<int64_t> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+
+    std::cout << name << "p50 " << samples[n / 2] << ", p99 " << samples[n * 99 / 100]
+              << ", p99.9 " << samples[n * 999 / 1000] << ", max " << samples[n - 1] << " ns\n";
+}
+
+void measure(const char *name, Method method, int threads)
+{
+    std::vector<std::vector<int64_t> > perThread(threads);
+    {
+        DiscardStdout discard;
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+            workers.push_back(std::thread([&, t] { perThread[t] = logLines(method); }));
+        for (int t = 0; t < threads; ++t)
+            workers[t].join();
+    }
+
+    std::vector<int64_t> all;
+    for (int t = 0; t < threads; ++t)
+        all.insert(all.end(), perThread[t].begin(), perThread[t].end());
+    report(name, all);
+}
+
+void measureAll(int threads)
+{
+    std::cout << threads << " thread(s), " << MESSAGES << " lines each\n";
+    measure("std::cout + endl : ", METHOD_COUT, threads);
+    measure("printf           : ", METHOD_PRINTF, threads);
+    measure("LOG_INFO         : ", METHOD_LOGGER, threads);
+}
+
+/*
+ * === Test 1: one thread logging ===
+ */
+namespace Test1
+{
+    void fn(void)
+    {
+        measureAll(1);
+    }
+}
+
+/*
+ * === Test 2: threads logging at the same time ===
+ */
+namespace Test2
+{
+    void fn(void)
+    {
+        measureAll(4);
+    }
+}
+
+REGISTER_TEST(1, "one thread");
+REGISTER_TEST(2, "4 threads, contending for the stream");
+
+int main(int argc, char *argv[])
+{
+    return runTests(argc, argv);
+}
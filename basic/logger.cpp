@@ -0,0 +1,212 @@
+#include "logger.h"
+#include "output_capture.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>      // snprintf()
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const char *s_levelNames[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+
+static const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+
+static int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - s_start).count();
+}
+
+/*
+ * Single producer(the owning thread), single consumer at a time: the writer,
+ * or the owning thread itself in flush(), which takes m_drain.
+ * m_tail is written by the producer only, m_head by the consumer only, each
+ * on its own cache line, and a record is published by the release store of
+ * m_tail after it's filled.
+ */
+struct LogRing
+{
+    LogRecord m_records[Logger::RING_SIZE];
+    std::atomic<uint64_t> m_tail;   // next record to fill
+    char m_pad[64];                 // not alignas(64), new can't align it before C++17
+    std::atomic<uint64_t> m_head;   // next record to write
+    std::atomic<bool> m_closed;     // the thread has exited
+    std::mutex m_drain;             // held by the consumer
+
+    LogRing() : m_tail(0), m_head(0), m_closed(false) { }
+};
+
+// write and flush what is published in ring, returns the number of records,
+// the caller holds ring->m_drain
+static size_t drain(LogRing *ring, std::ostream &out)
+{
+    uint64_t head = ring->m_head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->m_tail.load(std::memory_order_acquire);
+    if (head == tail)
+        return 0;
+
+    for (uint64_t k = head; k < tail; ++k) {
+        LogRecord &r = ring->m_records[k % Logger::RING_SIZE];
+        // not by manipulators, they would stick to std::cout
+        char prefix[48];
+        snprintf(prefix, sizeof(prefix), "[%5lld.%06lld] %s ",
+                 static_cast<long long>(r.m_time / 1000000000),
+                 static_cast<long long>(r.m_time / 1000 % 1000000),
+                 s_levelNames[r.m_level]);
+        out << prefix;
+        r.m_format(out, r.m_args);
+        out << '\n';
+    }
+    out.flush();
+
+    // the slots are free, and flush() may return
+    ring->m_head.store(tail, std::memory_order_release);
+    return static_cast<size_t>(tail - head);
+}
+
+class LogWriter
+{
+private:
+    std::mutex m_mutex;             // m_rings and starting the thread
+    std::vector<LogRing*> m_rings;
+    std::thread m_thread;
+    std::atomic<bool> m_stop;
+
+    // drain all rings once, drop the rings of exited threads when empty
+    size_t drainAll()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t count = 0;
+
+        for (size_t i = 0; i < m_rings.size(); ) {
+            LogRing *ring = m_rings[i];
+            bool closed = ring->m_closed.load(std::memory_order_acquire);
+            // with OutputCapture(runner -j N) std::cout dispatches by thread:
+            // a thread's lines are written by itself, to where its test goes
+            if (!closed && OutputCapture::isInstalled()) {
+                ++i;
+                continue;
+            }
+            {
+                std::unique_lock<std::mutex> drainLock(ring->m_drain, std::try_to_lock);
+                if (!drainLock.owns_lock()) {
+                    ++i;
+                    continue;
+                }
+                count += drain(ring, std::cout);
+            }
+
+            if (closed) {
+                delete ring;
+                m_rings[i] = m_rings.back();
+                m_rings.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        return count;
+    }
+
+    void loop()
+    {
+        while (!m_stop.load(std::memory_order_acquire)) {
+            if (drainAll() == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        drainAll();
+    }
+
+public:
+    LogWriter() : m_stop(false) { }
+
+    ~LogWriter()
+    {
+        m_stop.store(true, std::memory_order_release);
+        if (m_thread.joinable())
+            m_thread.join();
+        for (size_t i = 0; i < m_rings.size(); ++i)
+            delete m_rings[i];
+    }
+
+    LogRing* add()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable())
+            m_thread = std::thread(&LogWriter::loop, this);
+
+        LogRing *ring = new LogRing;
+        m_rings.push_back(ring);
+        return ring;
+    }
+};
+
+static LogWriter s_writer;
+
+// the owning thread writes its ring itself, to std::cout as it sees it
+static void drainOwn(LogRing *ring)
+{
+    std::lock_guard<std::mutex> lock(ring->m_drain);
+    drain(ring, std::cout);
+}
+
+// hands the ring to the writer when the thread exits
+class RingHolder
+{
+public:
+    LogRing *m_ring;
+
+    RingHolder() : m_ring(nullptr) { }
+    ~RingHolder()
+    {
+        if (m_ring) {
+            drainOwn(m_ring);   // while this thread's output target is still set
+            m_ring->m_closed.store(true, std::memory_order_release);
+        }
+        m_ring = nullptr;   // a later thread_local destructor logging gets a new ring
+    }
+};
+
+static thread_local RingHolder t_holder;
+
+static LogRing* threadRing()
+{
+    if (!t_holder.m_ring)
+        t_holder.m_ring = s_writer.add();
+    return t_holder.m_ring;
+}
+
+LogRecord* Logger::acquire()
+{
+    LogRing *ring = threadRing();
+    uint64_t tail = ring->m_tail.load(std::memory_order_relaxed);
+
+    // full: wait for the writer to free a slot, with OutputCapture the
+    // writer leaves it to this thread
+    while (tail - ring->m_head.load(std::memory_order_acquire) >= RING_SIZE) {
+        if (OutputCapture::isInstalled())
+            drainOwn(ring);
+        else
+            std::this_thread::yield();
+    }
+
+    LogRecord *r = &ring->m_records[tail % RING_SIZE];
+    r->m_time = now();
+    return r;
+}
+
+void Logger::publish()
+{
+    LogRing *ring = t_holder.m_ring;
+    ring->m_tail.store(ring->m_tail.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+}
+
+void Logger::flush()
+{
+    LogRing *ring = t_holder.m_ring;
+    if (!ring)
+        return;
+
+    // what the writer hasn't taken yet, in order with this thread's output
+    drainOwn(ring);
+}
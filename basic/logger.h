@@ -0,0 +1,138 @@
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <iostream>
+#include <cstddef>      // std::max_align_t
+#include <new>          // placement new
+#include <tuple>
+#include <type_traits>
+#include <utility>      // std::forward, std::index_sequence
+#include <stdint.h>
+
+/*
+ * Logger: asynchronous logging, the caller never formats or writes
+ *
+ *   LOG_WARN("Cannot find index ", index);
+ *
+ * writes "[    0.000123] WARN  Cannot find index 7" to std::cout, later, from a
+ * background thread. The arguments are streamed by operator<< in order.
+ *
+ * Why:
+ *   std::cout << ... << std::endl formats in the calling thread, takes the
+ *   stream's lock and flushes with a write(2) every line. Threads logging at
+ *   the same time wait for each other.
+ *
+ * How:
+ *   - every thread has its own ring buffer(single producer, single consumer),
+ *     logging takes no lock: copy the arguments into a slot and publish it
+ *   - formatting is deferred: the slot keeps the arguments as a std::tuple and
+ *     a pointer to the function formatting that tuple type
+ *   - the writer thread drains all rings, formats, and flushes once per batch
+ *   - levels below LOG_LEVEL are removed by the preprocessor, arguments are
+ *     not even evaluated, e.g. -DLOG_LEVEL=LOG_LEVEL_WARN
+ *
+ * NOTE:
+ *   - Arguments are copied, except pointers: a const char* must still be valid
+ *     when the writer formats it, e.g. a string literal. Pass a std::string
+ *     to copy the text.
+ *   - The arguments of one call must fit in PAYLOAD_SIZE bytes.
+ *   - A full ring makes the caller wait for the writer, nothing is dropped.
+ *   - Lines are not ordered with direct std::cout output, call flush() to
+ *     write everything logged so far, run() does at the end of a test.
+ *   - With OutputCapture installed(the runner's -j N), the writer leaves
+ *     running threads' rings alone: a thread writes its own lines in flush(),
+ *     on a full ring and when it exits, so they go to its test's output.
+ */
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Logger::log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Logger::log(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Logger::log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+// one slot of a ring, a cache line and a half
+struct LogRecord
+{
+    static const size_t SIZE = 128;
+
+    void (*m_format)(std::ostream &out, void *args);    // formats and destroys m_args
+    int64_t m_time;     // ns since the start of the program
+    int m_level;
+    alignas(std::max_align_t) unsigned char m_args[SIZE - 2 * alignof(std::max_align_t)];
+};
+
+static_assert(sizeof(LogRecord) == LogRecord::SIZE, "LogRecord must be one slot");
+
+class Logger
+{
+public:
+    static const size_t PAYLOAD_SIZE = sizeof(LogRecord().m_args);
+    static const size_t RING_SIZE = 1024;   // records per thread
+
+    template <class... Args>
+    static void log(int level, Args&&... args)
+    {
+        typedef std::tuple<typename std::decay<Args>::type...> args_t;
+        static_assert(sizeof(args_t) <= PAYLOAD_SIZE, "too many arguments to log");
+        static_assert(alignof(args_t) <= alignof(std::max_align_t), "over-aligned argument");
+
+        LogRecord *r = acquire();
+        r->m_format = &format<args_t>;
+        r->m_level = level;
+        new (r->m_args) args_t(std::forward<Args>(args)...);
+        publish();
+    }
+
+    // write everything this thread logged so far
+    static void flush();
+
+private:
+    // the calling thread's next free slot, waits while its ring is full
+    static LogRecord* acquire();
+    // makes the slot acquire() returned visible to the writer
+    static void publish();
+
+    template <class Tuple, size_t... I>
+    static void print(std::ostream &out, const Tuple &t, std::index_sequence<I...>)
+    {
+        int expand[] = { 0, ((out << std::get<I>(t)), 0)... };
+        (void)expand;
+    }
+
+    template <class Tuple>
+    static void format(std::ostream &out, void *args)
+    {
+        Tuple *t = static_cast<Tuple*>(args);
+        print(out, *t, std::make_index_sequence<std::tuple_size<Tuple>::value>());
+        t->~Tuple();
+    }
+};
+
+#endif
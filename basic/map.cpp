@@ -136,8 +136,10 @@ namespace Test2
         multimap_test();
     }
 }
-int main()
+REGISTER_TEST(1, "map");
+REGISTER_TEST(2, "multimap");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // map
-    run(2, &(Test2::fn)); // multimap
+    return runTests(argc, argv);
 }
@@ -0,0 +1,104 @@
+#include "mem_usage.h"
+#include <stdio.h>          // fopen(), fscanf()
+#include <stdlib.h>         // getenv()
+#include <unistd.h>         // sysconf()
+#include <sys/resource.h>   // getrusage()
+
+struct Sample
+{
+    long m_rssKb;       // -1 if /proc is not there
+    long m_peakKb;
+    long m_minorFaults;
+    long m_majorFaults;
+};
+
+static Sample s_begin;
+static Sample s_end;
+
+// resident pages, the 2nd field of /proc/self/statm
+static long residentKb()
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return -1;
+
+    long size = 0;
+    long resident = 0;
+    int n = fscanf(f, "%ld %ld", &size, &resident);
+    fclose(f);
+    if (n != 2)
+        return -1;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static Sample sample()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    Sample s;
+    s.m_rssKb = residentKb();
+    s.m_peakKb = usage.ru_maxrss;   // KB on Linux
+    s.m_minorFaults = usage.ru_minflt;
+    s.m_majorFaults = usage.ru_majflt;
+    return s;
+}
+
+static void printKb(std::ostream &out, long kb)
+{
+    if (kb < 0)
+        out << "n/a";
+    else if (kb >= 10 * 1024)
+        out << kb / 1024 << " MB";
+    else
+        out << kb << " KB";
+}
+
+// signed, e.g. +12 KB
+static void printDelta(std::ostream &out, long from, long to)
+{
+    long delta = to - from;
+    out << (delta < 0 ? "-" : "+");
+    printKb(out, delta < 0 ? -delta : delta);
+}
+
+bool MemUsage::isEnabled()
+{
+    static const char *value = getenv("LEARNCPP_MEM");
+    static const bool enabled = value && *value && *value != '0';
+    return enabled;
+}
+
+void MemUsage::begin()
+{
+    if (isEnabled())
+        s_begin = sample();
+}
+
+void MemUsage::end()
+{
+    if (isEnabled())
+        s_end = sample();
+}
+
+void MemUsage::report(std::ostream &out)
+{
+    if (!isEnabled())
+        return;
+
+    out << "--- memory: RSS ";
+    printKb(out, s_begin.m_rssKb);
+    out << " -> ";
+    printKb(out, s_end.m_rssKb);
+    if (s_begin.m_rssKb >= 0 && s_end.m_rssKb >= 0) {
+        out << " (";
+        printDelta(out, s_begin.m_rssKb, s_end.m_rssKb);
+        out << ")";
+    }
+    out << ", peak ";
+    printKb(out, s_end.m_peakKb);
+    out << " (";
+    printDelta(out, s_begin.m_peakKb, s_end.m_peakKb);
+    out << "), page faults " << s_end.m_minorFaults - s_begin.m_minorFaults << " minor, "
+        << s_end.m_majorFaults - s_begin.m_majorFaults << " major\n";
+}
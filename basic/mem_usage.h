@@ -0,0 +1,38 @@
+#ifndef _MEM_USAGE_H_
+#define _MEM_USAGE_H_
+
+#include <iostream>
+
+/*
+ * MemUsage: resident memory and page faults of each run() section
+ *
+ * Enable by environment variable:
+ *   LEARNCPP_MEM=1 ./map
+ * Then run() samples /proc/self/statm and getrusage(RUSAGE_SELF) before and
+ * after the test function and reports:
+ *   - RSS before, after, and the delta
+ *   - peak RSS of the process(ru_maxrss), and how much the section raised it
+ *   - minor and major page faults in the section
+ *
+ * A minor fault maps a page already in memory, e.g. the first touch of a
+ * page malloc() got from the kernel; a major fault reads it from disk.
+ *
+ * NOTE:
+ *   - The numbers are of the whole process, all threads.
+ *   - RSS drops only when the allocator returns memory to the kernel, a
+ *     freed container usually stays resident for the next one.
+ *   - The peak never goes down, a section below an earlier peak shows +0.
+ */
+class MemUsage
+{
+public:
+    // true if LEARNCPP_MEM is set
+    static bool isEnabled();
+
+    static void begin();
+    static void end();
+
+    static void report(std::ostream &out);
+};
+
+#endif
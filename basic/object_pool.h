@@ -0,0 +1,152 @@
+#ifndef _OBJECT_POOL_H_
+#define _OBJECT_POOL_H_
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * ObjectPool: recycle objects through std::unique_ptr deleters
+ *
+ * std::unique_ptr<T> calls delete when it dies, and the next new T asks the
+ * allocator again. For objects created and destroyed millions of times per
+ * second, ObjectPool<T>::acquire() returns a std::unique_ptr<T, Recycler>,
+ * whose deleter puts the object back to a free list of the current thread
+ * instead of freeing it.
+ *
+ *   Reuse = false: the deleter calls ~T() and keeps the memory only,
+ *                  acquire(args...) constructs a new T in it.
+ *   Reuse = true:  the deleter calls T::reset() and keeps the object alive,
+ *                  acquire(args...) hands it out again without construction,
+ *                  args are only used when the free list is empty.
+ *                  T must have reset().
+ *
+ * e.g.
+ *   ObjectPool<Request>::Ptr req = ObjectPool<Request>::acquire(42);
+ *   // req is back in the free list when it goes out of scope
+ *
+ * NOTE:
+ *   - The free list is thread_local, no lock at all. An object released by
+ *     another thread goes to that thread's free list.
+ *   - At most MAX_FREE objects are kept per thread, the rest are deleted.
+ *   - The pooled objects are freed when their thread exits, so don't keep a
+ *     Ptr alive after the thread which released it has exited.
+ */
+template <class T, bool Reuse = false>
+class ObjectPool
+{
+public:
+    static const size_t MAX_FREE = 4096;
+
+    class Recycler
+    {
+    public:
+        void operator()(T *obj) const { ObjectPool::release(obj); }
+    };
+
+    typedef std::unique_ptr<T, Recycler> Ptr;
+
+    template <class... Args>
+    static Ptr acquire(Args&&... args)
+    {
+        return Ptr(create(reuse_t(), std::forward<Args>(args)...));
+    }
+
+    // objects(or memory blocks) waiting in the current thread's free list
+    static size_t freeCount() { return freeList().m_objects.size(); }
+
+private:
+    // select the Reuse behaviour by overloading, as both branches can't be
+    // compiled for every T
+    typedef std::integral_constant<bool, Reuse> reuse_t;
+
+    // alignas(64) and the like need the aligned operator new/delete
+    typedef std::integral_constant<bool, (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)> overaligned_t;
+
+    static void* allocate(std::false_type) { return ::operator new(sizeof(T)); }
+    static void* allocate(std::true_type) { return ::operator new(sizeof(T), std::align_val_t(alignof(T))); }
+    static void deallocate(void *mem, std::false_type) { ::operator delete(mem); }
+    static void deallocate(void *mem, std::true_type) { ::operator delete(mem, std::align_val_t(alignof(T))); }
+
+    // free list of one thread, emptied when the thread exits
+    class FreeList
+    {
+    public:
+        std::vector<T*> m_objects;
+
+        // reserve it once, release() can't throw bad_alloc from a deleter
+        FreeList() { m_objects.reserve(MAX_FREE); }
+
+        ~FreeList()
+        {
+            for (size_t i = 0; i < m_objects.size(); ++i)
+                destroy(m_objects[i], reuse_t());
+        }
+    };
+
+    static FreeList& freeList()
+    {
+        static thread_local FreeList s_list;
+        return s_list;
+    }
+
+    // Reuse = true: hand out a constructed object
+    template <class... Args>
+    static T* create(std::true_type, Args&&... args)
+    {
+        std::vector<T*> &list = freeList().m_objects;
+        if (list.empty())
+            return new T(std::forward<Args>(args)...);
+
+        T *obj = list.back();
+        list.pop_back();
+        return obj;
+    }
+
+    // Reuse = false: construct a new object in the recycled memory
+    template <class... Args>
+    static T* create(std::false_type, Args&&... args)
+    {
+        std::vector<T*> &list = freeList().m_objects;
+        void *mem;
+        if (list.empty()) {
+            mem = allocate(overaligned_t());
+        } else {
+            mem = list.back();
+            list.pop_back();
+        }
+
+        try
+        {
+            return new (mem) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            // the constructor failed, keep the memory for the next one
+            list.push_back(static_cast<T*>(mem));
+            throw;
+        }
+    }
+
+    static void recycle(T *obj, std::true_type) { obj->reset(); }
+    static void recycle(T *obj, std::false_type) { obj->~T(); }
+
+    // really free an object kept by the pool
+    static void destroy(T *obj, std::true_type) { delete obj; }
+    static void destroy(T *obj, std::false_type) { deallocate(obj, overaligned_t()); } // destructed in recycle()
+
+    static void release(T *obj)
+    {
+        recycle(obj, reuse_t());
+
+        std::vector<T*> &list = freeList().m_objects;
+        if (list.size() < MAX_FREE)
+            list.push_back(obj);
+        else
+            destroy(obj, reuse_t());
+    }
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "output_capture.h"
+#include <atomic>
+
+// the calling thread's target, nullptr writes to the original buffer
+static thread_local std::streambuf *t_target = nullptr;
+
+// unbuffered: every write is forwarded at once, by the writing thread
+class DispatchBuffer : public std::streambuf
+{
+private:
+    std::streambuf *m_default;
+
+    std::streambuf* target() const { return t_target ? t_target : m_default; }
+
+protected:
+    int overflow(int c)
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        return target()->sputc(traits_type::to_char_type(c));
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n)
+    {
+        return target()->sputn(s, n);
+    }
+
+    int sync()
+    {
+        return target()->pubsync();
+    }
+
+public:
+    DispatchBuffer() : m_default(nullptr) { }
+
+    void setDefault(std::streambuf *buf) { m_default = buf; }
+    std::streambuf* getDefault() const { return m_default; }
+};
+
+static DispatchBuffer s_outBuf;
+static DispatchBuffer s_errBuf;
+static DispatchBuffer s_logBuf;
+// atomic: the logger's writer thread checks it(logger.cpp)
+static std::atomic<bool> s_installed(false);
+
+void OutputCapture::install()
+{
+    if (s_installed)
+        return;
+
+    std::cout.flush();
+    s_outBuf.setDefault(std::cout.rdbuf(&s_outBuf));
+    s_errBuf.setDefault(std::cerr.rdbuf(&s_errBuf));
+    s_logBuf.setDefault(std::clog.rdbuf(&s_logBuf));
+    s_installed = true;
+}
+
+void OutputCapture::uninstall()
+{
+    if (!s_installed)
+        return;
+
+    std::cout.flush();
+    std::cout.rdbuf(s_outBuf.getDefault());
+    std::cerr.rdbuf(s_errBuf.getDefault());
+    std::clog.rdbuf(s_logBuf.getDefault());
+    s_installed = false;
+}
+
+bool OutputCapture::isInstalled()
+{
+    return s_installed;
+}
+
+void OutputCapture::setThreadTarget(std::streambuf *buf)
+{
+    t_target = buf;
+}
+
+OutputCapture::Scope::Scope(std::streambuf *buf)
+    : m_prev(nullptr), m_out(nullptr), m_err(nullptr), m_log(nullptr)
+{
+    if (s_installed) {
+        m_prev = t_target;
+        t_target = buf;
+    } else {
+        m_out = std::cout.rdbuf(buf);
+        m_err = std::cerr.rdbuf(buf);
+        m_log = std::clog.rdbuf(buf);
+    }
+}
+
+OutputCapture::Scope::~Scope()
+{
+    if (m_out) {
+        std::cout.rdbuf(m_out);
+        std::cerr.rdbuf(m_err);
+        std::clog.rdbuf(m_log);
+    } else {
+        t_target = m_prev;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef _OUTPUT_CAPTURE_H_
+#define _OUTPUT_CAPTURE_H_
+
+#include <iostream>
+
+/*
+ * OutputCapture: redirect std::cout, std::cerr and std::clog of one thread
+ *
+ *   std::stringbuf buf;
+ *   {
+ *       OutputCapture::Scope capture(&buf);
+ *       std::cout << "to buf\n";     // only this thread's writes
+ *   }
+ *   std::cout << buf.str();
+ *
+ * install() puts a dispatching buffer into the three streams, it forwards
+ * each write to the buffer of the writing thread's innermost Scope, or to the
+ * original one. Without install(), a Scope swaps the streams' buffers, which
+ * redirects all threads.
+ *
+ * NOTE:
+ *   - Only the standard streams are redirected, not printf() or write(1).
+ *   - The streams' format flags(std::hex, precision, ...) are still shared by
+ *     all threads.
+ *   - Call install()/uninstall() while no other thread writes the streams.
+ */
+class OutputCapture
+{
+public:
+    static void install();
+    static void uninstall();
+    static bool isInstalled();
+
+    // installed only: this thread writes to buf for the rest of its life,
+    // thread_local destructors too
+    static void setThreadTarget(std::streambuf *buf);
+
+    class Scope
+    {
+    private:
+        std::streambuf *m_prev;         // installed: the thread's previous target
+        std::streambuf *m_out;          // not installed: the streams' buffers
+        std::streambuf *m_err;
+        std::streambuf *m_log;
+
+    public:
+        explicit Scope(std::streambuf *buf);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope& operator=(const Scope &) = delete;
+    };
+};
+
+#endif
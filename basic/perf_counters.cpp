@@ -0,0 +1,184 @@
+#include "perf_counters.h"
+#include <string.h>     // memset(), strerror()
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>     // getenv()
+#include <unistd.h>     // syscall(), read(), close()
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+enum Counter
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_MAX,
+};
+
+static const uint64_t s_configs[COUNTER_MAX] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int s_fds[COUNTER_MAX] = { -1, -1, -1, -1 };
+static bool s_opened = false;
+static bool s_available = false;
+static long s_operations = 0;
+
+// one counter, read with PERF_FORMAT_TOTAL_TIME_ENABLED/RUNNING
+struct Reading
+{
+    bool m_valid;
+    bool m_scaled;      // multiplexed, m_value is estimated
+    double m_value;
+};
+
+static int openCounter(uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;           // threads created later
+    attr.exclude_kernel = 1;    // allowed with perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// open all counters at the first begin(), tell once if it's not possible
+static void openCounters()
+{
+    s_opened = true;
+
+    for (int i = 0; i < COUNTER_MAX; ++i)
+        s_fds[i] = openCounter(s_configs[i]);
+
+    // without cycles and instructions there is nothing useful to show
+    if (s_fds[COUNTER_CYCLES] < 0 || s_fds[COUNTER_INSTRUCTIONS] < 0) {
+        int error = errno;
+        std::cout << "--- perf: counters unavailable(" << strerror(error) << ")";
+        if (error == EACCES || error == EPERM)
+            std::cout << ", check kernel.perf_event_paranoid";
+        std::cout << "\n";
+        for (int i = 0; i < COUNTER_MAX; ++i) {
+            if (s_fds[i] >= 0)
+                close(s_fds[i]);
+            s_fds[i] = -1;
+        }
+        return;
+    }
+    s_available = true;
+}
+
+static Reading readCounter(int fd)
+{
+    Reading r = { false, false, 0 };
+    uint64_t buf[3];    // value, time enabled, time running
+    if (fd < 0 || read(fd, buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0)
+        return r;
+
+    r.m_valid = true;
+    r.m_scaled = buf[2] < buf[1];
+    r.m_value = static_cast<double>(buf[0]) * buf[1] / buf[2];
+    return r;
+}
+
+static void printCount(std::ostream &out, const char *name, const Reading &r)
+{
+    out << name << " ";
+    if (!r.m_valid)
+        out << "n/a";
+    else
+        out << (r.m_scaled ? "~" : "") << static_cast<uint64_t>(r.m_value);
+}
+
+// misses per 1000 instructions, and per operation
+static void printMisses(std::ostream &out, const char *name, const Reading &r, double instructions)
+{
+    printCount(out, name, r);
+    if (!r.m_valid)
+        return;
+    out << " (" << r.m_value * 1000 / instructions << "/k instr";
+    if (s_operations > 0)
+        out << ", " << r.m_value / s_operations << "/op";
+    out << ")";
+}
+
+bool PerfCounters::isEnabled()
+{
+    static const char *value = getenv("LEARNCPP_PERF");
+    static const bool enabled = value && *value && *value != '0';
+    return enabled;
+}
+
+void PerfCounters::begin()
+{
+    if (!isEnabled())
+        return;
+    if (!s_opened)
+        openCounters();
+    if (!s_available)
+        return;
+
+    s_operations = 0;
+    for (int i = 0; i < COUNTER_MAX; ++i) {
+        if (s_fds[i] >= 0) {
+            ioctl(s_fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(s_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::end()
+{
+    if (!s_available)
+        return;
+
+    for (int i = 0; i < COUNTER_MAX; ++i) {
+        if (s_fds[i] >= 0)
+            ioctl(s_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+void PerfCounters::setOperations(long n)
+{
+    s_operations = n;
+}
+
+void PerfCounters::report(std::ostream &out)
+{
+    if (!s_available)
+        return;
+
+    Reading r[COUNTER_MAX];
+    for (int i = 0; i < COUNTER_MAX; ++i)
+        r[i] = readCounter(s_fds[i]);
+
+    const Reading &cycles = r[COUNTER_CYCLES];
+    const Reading &instructions = r[COUNTER_INSTRUCTIONS];
+    if (!cycles.m_valid || !instructions.m_valid || instructions.m_value == 0) {
+        out << "--- perf: no samples\n";
+        return;
+    }
+
+    out << "--- perf: ";
+    printCount(out, "cycles", cycles);
+    out << ", ";
+    printCount(out, "instructions", instructions);
+    out << ", IPC " << instructions.m_value / cycles.m_value;
+    if (s_operations > 0)
+        out << ", " << instructions.m_value / s_operations << " instr/op";
+    out << "\n            ";
+    printMisses(out, "cache misses", r[COUNTER_CACHE_MISSES], instructions.m_value);
+    out << ", ";
+    printMisses(out, "branch misses", r[COUNTER_BRANCH_MISSES], instructions.m_value);
+    out << "\n";
+}
@@ -0,0 +1,48 @@
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+
+#include <iostream>
+
+/*
+ * PerfCounters: hardware counters of each run() section
+ *
+ * Enable by environment variable:
+ *   LEARNCPP_PERF=1 ./vector
+ * Then run() counts, around the test function(user space only):
+ *   - cycles and instructions, and IPC = instructions / cycles
+ *   - cache misses(last level), per 1000 instructions
+ *   - branch misses, per 1000 instructions
+ *
+ * A test knowing how many operations it runs can call setOperations(n),
+ * the report shows the counts per operation too.
+ *
+ * Counters come from perf_event_open(2). If they are unavailable, e.g. in a
+ * container, a VM without a PMU, or with kernel.perf_event_paranoid > 2,
+ * it says so once and the tests run as usual. A counter the CPU doesn't
+ * have is reported as "n/a".
+ *
+ * NOTE:
+ *   - Threads created by the test are counted too.
+ *   - When the PMU has too few registers the kernel multiplexes the counters,
+ *     the counts are scaled and marked by "~".
+ *   - Use -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+class PerfCounters
+{
+public:
+    // true if LEARNCPP_PERF is set
+    static bool isEnabled();
+
+    // reset and start the counters
+    static void begin();
+
+    // stop the counters
+    static void end();
+
+    // the test function ran n operations, for the per operation numbers
+    static void setOperations(long n);
+
+    static void report(std::ostream &out);
+};
+
+#endif
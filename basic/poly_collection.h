@@ -0,0 +1,114 @@
+#ifndef _POLY_COLLECTION_H_
+#define _POLY_COLLECTION_H_
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * PolyCollection: objects of a hierarchy, stored by their concrete types
+ *
+ *   PolyCollection<Animal, Cat, Dog, Cow> zoo;
+ *   zoo.insert(Cat(...));
+ *   zoo.insert(Dog(...));
+ *
+ *   zoo.forEach([](auto &animal) { animal.speak(); });  // Cat&, then Dog&, ...
+ *   zoo.forEachBase([](Animal &animal) { animal.speak(); });
+ *
+ * std::vector<Animal*> of mixed types calls every speak() through the vtable,
+ * the indirect branch target changes from object to object, so it's often
+ * mispredicted, and every object is a separate allocation.
+ * PolyCollection keeps one std::vector per concrete type(a segment):
+ *   - objects are contiguous, no allocation per object
+ *   - forEach() calls f with the concrete type, T&, the compiler binds the
+ *     call statically and can inline it if T or the function is final
+ *   - forEachBase() still calls through Base&, but one type after another,
+ *     the branch predictor sees the same target for a whole segment
+ *
+ * NOTE:
+ *   - The types are listed at compile time, insert() of another type doesn't
+ *     compile.
+ *   - The order between segments is lost: Cats first, then Dogs, ...
+ *   - insert() may move a segment, pointers to its objects are invalidated.
+ */
+template <class Base, class... Types>
+class PolyCollection
+{
+private:
+    std::tuple<std::vector<Types>...> m_segments;
+
+    // is T one of Types
+    template <class T, class... Ts>
+    struct contains : std::false_type { };
+
+    template <class T, class First, class... Ts>
+    struct contains<T, First, Ts...>
+        : std::conditional<std::is_same<T, First>::value, std::true_type, contains<T, Ts...> >::type
+    { };
+
+    template <class T, class F>
+    static void visit(std::vector<T> &segment, F &f)
+    {
+        for (T &obj : segment)
+            f(obj);
+    }
+
+public:
+    template <class T>
+    std::vector<T>& segment()
+    {
+        static_assert(contains<T, Types...>::value, "not a type of this PolyCollection");
+        static_assert(std::is_base_of<Base, T>::value, "not derived from Base");
+        return std::get<std::vector<T> >(m_segments);
+    }
+
+    template <class T>
+    void insert(T &&obj)
+    {
+        segment<typename std::decay<T>::type>().push_back(std::forward<T>(obj));
+    }
+
+    template <class T, class... Args>
+    T& emplace(Args&&... args)
+    {
+        std::vector<T> &s = segment<T>();
+        s.emplace_back(std::forward<Args>(args)...);
+        return s.back();
+    }
+
+    template <class T>
+    void reserve(size_t count) { segment<T>().reserve(count); }
+
+    // f(T&) for every object, segment by segment in the order of Types
+    template <class F>
+    void forEach(F f)
+    {
+        int expand[] = { 0, (visit(std::get<std::vector<Types> >(m_segments), f), 0)... };
+        (void)expand;
+    }
+
+    // f(Base&) for every object
+    template <class F>
+    void forEachBase(F f)
+    {
+        forEach([&f](Base &obj) { f(obj); });
+    }
+
+    size_t size() const
+    {
+        size_t sizes[] = { 0, std::get<std::vector<Types> >(m_segments).size()... };
+        size_t total = 0;
+        for (size_t s : sizes)
+            total += s;
+        return total;
+    }
+
+    void clear()
+    {
+        int expand[] = { 0, (std::get<std::vector<Types> >(m_segments).clear(), 0)... };
+        (void)expand;
+    }
+};
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef _POLY_VECTOR_H_
+#define _POLY_VECTOR_H_
+
+#include <cstddef>      // std::max_align_t
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+
+/*
+ * PolyVector: objects of any type derived from Base, inline in one buffer
+ *
+ *   PolyVector<Base> v;
+ *   v.push_back(Base(5));
+ *   v.push_back(Derived(6));      // not sliced, a whole Derived
+ *   for (Base &b : v)
+ *       b.getName();              // "Base", "Derived"
+ *
+ * std::vector<Base> slices a Derived to its Base part(virtual_func.cpp
+ * Test 7), std::vector<std::unique_ptr<Base>> allocates every object on its
+ * own. PolyVector puts the objects one after another in a single buffer:
+ *
+ *   | Record | Derived ... | Record | Base ... | Record | Other ... |
+ *
+ * Every object has a Record in front of it:
+ *   - m_ops:  functions of its concrete type, to move and destroy it
+ *   - m_base: offset to its Base subobject(past the object start with
+ *             multiple inheritance), iterating needs no function call
+ *   - m_next: bytes to the next record
+ *
+ * The buffer is aligned for std::max_align_t, every object at its own
+ * alignment. Growing doubles the buffer and move-constructs each object into
+ * the same offset of the new one, so the layout and the offsets don't change.
+ *
+ * NOTE:
+ *   - Types must be nothrow move constructible, a throwing move would leave
+ *     the objects half in the old buffer.
+ *   - Growing invalidates references, like std::vector.
+ *   - Base doesn't need a virtual destructor, objects are destroyed as their
+ *     concrete type.
+ */
+template <class Base>
+class PolyVector
+{
+private:
+    struct Ops
+    {
+        void (*m_move)(void *dst, void *src);   // move-construct dst, destroy src
+        void (*m_destroy)(void *obj);
+    };
+
+    struct Record
+    {
+        const Ops *m_ops;
+        uint32_t m_object;  // from the record to the object
+        uint32_t m_base;    // from the record to its Base
+        uint32_t m_next;    // from the record to the next one
+    };
+
+    template <class T>
+    struct OpsOf
+    {
+        static void move(void *dst, void *src)
+        {
+            T *obj = static_cast<T*>(src);
+            new (dst) T(std::move(*obj));
+            obj->~T();
+        }
+
+        static void destroy(void *obj) { static_cast<T*>(obj)->~T(); }
+
+        static const Ops s_ops;
+    };
+
+    static const size_t ALIGN = alignof(std::max_align_t);
+
+    unsigned char *m_buf;
+    size_t m_used;      // bytes
+    size_t m_capacity;
+    size_t m_size;      // objects
+
+    static size_t alignUp(size_t n, size_t align) { return (n + align - 1) / align * align; }
+
+    Record* record(size_t offset) const { return reinterpret_cast<Record*>(m_buf + offset); }
+
+    static Base* baseOf(Record *r)
+    {
+        return reinterpret_cast<Base*>(reinterpret_cast<unsigned char*>(r) + r->m_base);
+    }
+
+    void grow(size_t need)
+    {
+        size_t capacity = m_capacity ? m_capacity * 2 : 256;
+        while (capacity < need)
+            capacity *= 2;
+
+        unsigned char *buf = static_cast<unsigned char*>(::operator new(capacity));
+        for (size_t offset = 0; offset < m_used; ) {
+            Record *from = record(offset);
+            Record *to = reinterpret_cast<Record*>(buf + offset);
+            *to = *from;
+            from->m_ops->m_move(buf + offset + from->m_object, m_buf + offset + from->m_object);
+            offset += from->m_next;
+        }
+
+        ::operator delete(m_buf);
+        m_buf = buf;
+        m_capacity = capacity;
+    }
+
+public:
+    class iterator
+    {
+    private:
+        unsigned char *m_pos;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Base value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Base* pointer;
+        typedef Base& reference;
+
+        explicit iterator(unsigned char *pos) : m_pos(pos) { }
+
+        Base& operator*() const { return *baseOf(reinterpret_cast<Record*>(m_pos)); }
+        Base* operator->() const { return baseOf(reinterpret_cast<Record*>(m_pos)); }
+
+        iterator& operator++()
+        {
+            m_pos += reinterpret_cast<Record*>(m_pos)->m_next;
+            return *this;
+        }
+
+        bool operator==(const iterator &it) const { return m_pos == it.m_pos; }
+        bool operator!=(const iterator &it) const { return m_pos != it.m_pos; }
+    };
+
+    PolyVector() : m_buf(nullptr), m_used(0), m_capacity(0), m_size(0) { }
+    ~PolyVector() { clear(); ::operator delete(m_buf); }
+
+    PolyVector(const PolyVector &) = delete;
+    PolyVector& operator=(const PolyVector &) = delete;
+
+    PolyVector(PolyVector &&v) noexcept
+        : m_buf(v.m_buf), m_used(v.m_used), m_capacity(v.m_capacity), m_size(v.m_size)
+    {
+        v.m_buf = nullptr;
+        v.m_used = v.m_capacity = v.m_size = 0;
+    }
+
+    PolyVector& operator=(PolyVector &&v) noexcept
+    {
+        if (&v != this) {
+            clear();
+            ::operator delete(m_buf);
+            m_buf = v.m_buf;
+            m_used = v.m_used;
+            m_capacity = v.m_capacity;
+            m_size = v.m_size;
+            v.m_buf = nullptr;
+            v.m_used = v.m_capacity = v.m_size = 0;
+        }
+        return *this;
+    }
+
+    template <class T, class... Args>
+    T& emplace_back(Args&&... args)
+    {
+        static_assert(std::is_base_of<Base, T>::value, "not derived from Base");
+        static_assert(alignof(T) <= ALIGN, "over-aligned type");
+        static_assert(std::is_nothrow_move_constructible<T>::value,
+                      "the move constructor must be noexcept to grow the buffer");
+
+        // aligned in the buffer, growing keeps the offsets
+        size_t object = alignUp(m_used + sizeof(Record), alignof(T)) - m_used;
+        size_t next = alignUp(m_used + object + sizeof(T), alignof(Record)) - m_used;
+        if (m_used + next > m_capacity)
+            grow(m_used + next);
+
+        Record *r = record(m_used);
+        T *obj = new (m_buf + m_used + object) T(std::forward<Args>(args)...);
+
+        r->m_ops = &OpsOf<T>::s_ops;
+        r->m_object = static_cast<uint32_t>(object);
+        r->m_base = static_cast<uint32_t>(reinterpret_cast<unsigned char*>(static_cast<Base*>(obj))
+                                          - reinterpret_cast<unsigned char*>(r));
+        r->m_next = static_cast<uint32_t>(next);
+
+        m_used += next;
+        ++m_size;
+        return *obj;
+    }
+
+    template <class T>
+    void push_back(T &&obj)
+    {
+        emplace_back<typename std::decay<T>::type>(std::forward<T>(obj));
+    }
+
+    // bytes for the objects and their records
+    void reserve(size_t bytes)
+    {
+        if (bytes > m_capacity)
+            grow(bytes);
+    }
+
+    void clear()
+    {
+        for (size_t offset = 0; offset < m_used; ) {
+            Record *r = record(offset);
+            r->m_ops->m_destroy(m_buf + offset + r->m_object);
+            offset += r->m_next;
+        }
+        m_used = 0;
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t bytes() const { return m_used; }
+
+    iterator begin() { return iterator(m_buf); }
+    iterator end() { return iterator(m_buf + m_used); }
+};
+
+template <class Base>
+template <class T>
+const typename PolyVector<Base>::Ops PolyVector<Base>::OpsOf<T>::s_ops = {
+    &PolyVector<Base>::OpsOf<T>::move,
+    &PolyVector<Base>::OpsOf<T>::destroy,
+};
+
+#endif
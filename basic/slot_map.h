@@ -0,0 +1,140 @@
+#ifndef _SLOT_MAP_H_
+#define _SLOT_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/*
+ * SlotMap: objects stored contiguously, referred to by generational handles
+ *
+ * Instead of std::shared_ptr for owning and std::weak_ptr for observing, the
+ * SlotMap owns all objects and hands out SlotHandle{index, generation}:
+ *   - insert(): O(1) amortized, no allocation per object
+ *   - get(handle): O(1), returns nullptr if the object has been erased
+ *   - erase(handle): O(1), the last object is moved into the hole
+ *   - objects are dense in one std::vector, begin()/end() iterate them
+ *
+ * How a stale handle is detected:
+ *   every slot has a generation, bumped when its object is erased. A handle
+ *   remembers the generation at insert(), it's stale once they differ.
+ *
+ *   m_slots[handle.index] --> {dense index, generation}
+ *   m_values[dense index]  --> the object
+ *   m_owners[dense index]  --> slot index, to fix the slot when moving objects
+ *
+ * NOTE:
+ *   Pointers and references from get() are invalidated by insert() and
+ *   erase(), keep handles instead.
+ *   A 32-bit generation wraps after 4 billion erases of the same slot.
+ */
+struct SlotHandle
+{
+    uint32_t m_index;
+    uint32_t m_generation;
+
+    SlotHandle() : m_index(UINT32_MAX), m_generation(0) { }
+    SlotHandle(uint32_t index, uint32_t generation) : m_index(index), m_generation(generation) { }
+
+    bool operator==(const SlotHandle &h) const
+    {
+        return m_index == h.m_index && m_generation == h.m_generation;
+    }
+    bool operator!=(const SlotHandle &h) const { return !(*this == h); }
+};
+
+template <class T>
+class SlotMap
+{
+private:
+    struct Slot
+    {
+        uint32_t m_dense;       // index in m_values, or the next free slot
+        uint32_t m_generation;
+    };
+
+    std::vector<T> m_values;
+    std::vector<uint32_t> m_owners;
+    std::vector<Slot> m_slots;
+    uint32_t m_freeHead;        // list of free slots, linked by m_dense
+
+public:
+    typedef typename std::vector<T>::iterator iterator;
+
+    SlotMap() : m_freeHead(UINT32_MAX) { }
+
+    void reserve(size_t count)
+    {
+        m_values.reserve(count);
+        m_owners.reserve(count);
+        m_slots.reserve(count);
+    }
+
+    template <class... Args>
+    SlotHandle insert(Args&&... args)
+    {
+        uint32_t index;
+        if (m_freeHead != UINT32_MAX) {
+            index = m_freeHead;
+            m_freeHead = m_slots[index].m_dense;
+        } else {
+            index = static_cast<uint32_t>(m_slots.size());
+            Slot slot = { 0, 0 };
+            m_slots.push_back(slot);
+        }
+
+        m_slots[index].m_dense = static_cast<uint32_t>(m_values.size());
+        m_values.emplace_back(std::forward<Args>(args)...);
+        m_owners.push_back(index);
+
+        return SlotHandle(index, m_slots[index].m_generation);
+    }
+
+    T* get(SlotHandle h)
+    {
+        if (h.m_index >= m_slots.size() || m_slots[h.m_index].m_generation != h.m_generation)
+            return nullptr;
+        return &m_values[m_slots[h.m_index].m_dense];
+    }
+
+    const T* get(SlotHandle h) const
+    {
+        return const_cast<SlotMap*>(this)->get(h);
+    }
+
+    bool contains(SlotHandle h) const { return get(h) != nullptr; }
+
+    bool erase(SlotHandle h)
+    {
+        if (!contains(h))
+            return false;
+
+        Slot &slot = m_slots[h.m_index];
+        uint32_t dense = slot.m_dense;
+        uint32_t last = static_cast<uint32_t>(m_values.size() - 1);
+
+        // fill the hole with the last object
+        if (dense != last) {
+            m_values[dense] = std::move(m_values[last]);
+            m_owners[dense] = m_owners[last];
+            m_slots[m_owners[dense]].m_dense = dense;
+        }
+        m_values.pop_back();
+        m_owners.pop_back();
+
+        // invalidate all handles to this slot, then free it
+        ++slot.m_generation;
+        slot.m_dense = m_freeHead;
+        m_freeHead = h.m_index;
+        return true;
+    }
+
+    size_t size() const { return m_values.size(); }
+    bool empty() const { return m_values.empty(); }
+
+    iterator begin() { return m_values.begin(); }
+    iterator end() { return m_values.end(); }
+};
+
+#endif
@@ -1,9 +1,19 @@
 #include "global.h"
+#include "perf_counters.h"
+#include "intrusive_ptr.h"
+#include "local_shared_ptr.h"
+#include "object_pool.h"
+#include "atomic_shared_ptr.h"
+#include "slot_map.h"
 #include "math.h"
 #include <exception>    // std::exception
 #include <stdexcept>    // std::runtime_error
 #include <utility>      // std::move
 #include <memory>       // std::unique_ptr, std::shared_ptr
+#include <type_traits>  // std::is_nothrow_move_constructible
+#include <thread>       // std::thread
+#include <mutex>        // std::mutex
+#include <atomic>       // std::atomic
 
 /*
  * === Test 1: smart pointer and move semantics ===
@@ -383,7 +393,8 @@ namespace Test3
 
         // Move constructor
         // Transfer ownership of a.m_ptr to m_ptr
-        Auto_ptr4(Auto_ptr4&& a)
+        // NOTE: noexcept, otherwise std::vector copies it on reallocation(Test 8)
+        Auto_ptr4(Auto_ptr4&& a) noexcept
             : m_ptr(a.m_ptr)
         {
             a.m_ptr = nullptr; // NOTE: avoid later calling a dangling pointer
@@ -409,7 +420,7 @@ namespace Test3
 
         // Move assignment
         // Transfer ownership of a.m_ptr to m_ptr
-        Auto_ptr4& operator=(Auto_ptr4&& a)
+        Auto_ptr4& operator=(Auto_ptr4&& a) noexcept
         {
             // Self-assignment detection
             if (&a == this)
@@ -430,6 +441,11 @@ namespace Test3
         bool isNull() const { return m_ptr == nullptr; }
     };
 
+    static_assert(std::is_nothrow_move_constructible<Auto_ptr4<Resource> >::value,
+                  "Auto_ptr4 move constructor must be noexcept");
+    static_assert(std::is_nothrow_move_assignable<Auto_ptr4<Resource> >::value,
+                  "Auto_ptr4 move assignment must be noexcept");
+
     Auto_ptr4<Resource> generateResource4()
     {
         Auto_ptr4<Resource> res(new Resource);
@@ -865,13 +881,860 @@ namespace Test7
     }
 }
 
-int main()
+/*
+ * === Test 8: noexcept move and std::move_if_noexcept ===
+ *
+ * When std::vector grows, it allocates a new buffer and transfers the old
+ * elements. It has to give the strong exception guarantee: if anything
+ * throws, the old vector is unchanged. A move that throws half way would have
+ * destroyed the old elements already, so std::vector only moves elements
+ * whose move constructor is noexcept, otherwise it copies them.
+ *
+ * It's done by std::move_if_noexcept(x):
+ *   - returns T&&(move) if T's move constructor is noexcept, or T is not copyable
+ *   - returns const T&(copy) otherwise
+ *
+ * NOTE:
+ *   A move constructor never allocates, mark it noexcept. The compiler does
+ *   not infer it for user-defined moves, without it every growth silently
+ *   deep copies all elements.
+ *   static_assert(std::is_nothrow_move_constructible<T>::value) catches the
+ *   regression when compiling, see Auto_ptr4 in Test 3.
+ */
+namespace Test8
+{
+    // an owning element with a 64-int heap buffer, Noexcept decides whether
+    // the move constructor is marked noexcept
+    template <bool Noexcept>
+    class Buffer
+    {
+    private:
+        int *m_data;
+        int m_size;
+
+    public:
+        static int s_copies;
+        static int s_moves;
+
+        Buffer(int size = 64)
+            : m_data(new int[size]()), m_size(size)
+        {
+        }
+
+        ~Buffer()
+        {
+            delete [] m_data;
+        }
+
+        Buffer(const Buffer &b)
+            : m_data(new int[b.m_size]), m_size(b.m_size)
+        {
+            for (int i = 0; i < m_size; ++i)
+                m_data[i] = b.m_data[i];
+            ++s_copies;
+        }
+
+        Buffer(Buffer &&b) noexcept(Noexcept)
+            : m_data(b.m_data), m_size(b.m_size)
+        {
+            b.m_data = nullptr;
+            b.m_size = 0;
+            ++s_moves;
+        }
+
+        Buffer& operator=(const Buffer &b) = delete;
+        Buffer& operator=(Buffer &&b) = delete;
+    };
+
+    template <bool Noexcept>
+    int Buffer<Noexcept>::s_copies = 0;
+    template <bool Noexcept>
+    int Buffer<Noexcept>::s_moves = 0;
+
+    static_assert(std::is_nothrow_move_constructible<Buffer<true> >::value,
+                  "Buffer<true> should be noexcept movable");
+    static_assert(!std::is_nothrow_move_constructible<Buffer<false> >::value,
+                  "Buffer<false> should fall back to copy");
+
+    void sp_move_if_noexcept(void)
+    {
+        Buffer<true> a;
+        Buffer<false> b;
+
+        Buffer<true> a2(std::move_if_noexcept(a));
+        Buffer<false> b2(std::move_if_noexcept(b));
+
+        std::cout << "Buffer<true>:  moves " << Buffer<true>::s_moves
+                  << ", copies " << Buffer<true>::s_copies << "\n";
+        std::cout << "Buffer<false>: moves " << Buffer<false>::s_moves
+                  << ", copies " << Buffer<false>::s_copies << "\n";
+    }
+
+    template <bool Noexcept>
+    void benchGrow(const char *name, int count)
+    {
+        Buffer<Noexcept>::s_copies = 0;
+        Buffer<Noexcept>::s_moves = 0;
+
+        Timer t;
+        {
+            std::vector<Buffer<Noexcept> > v; // no reserve(), let it grow
+            for (int i = 0; i < count; ++i)
+                v.emplace_back();
+        }
+        double ms = t.elapsed() * 1e3;
+
+        std::cout << name << ": " << ms << " ms, "
+                  << Buffer<Noexcept>::s_moves << " moves, "
+                  << Buffer<Noexcept>::s_copies << " copies\n";
+    }
+
+    void sp_vector_grow(void)
+    {
+        const int count = 200000;
+
+        std::cout << "push " << count << " elements into an empty vector\n";
+        benchGrow<true>("noexcept move   ", count);
+        benchGrow<false>("copy fallback   ", count);
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< std::move_if_noexcept >>>\n";
+        sp_move_if_noexcept();
+
+        std::cout << "\n<<< vector reallocation >>>\n";
+        sp_vector_grow();
+    }
+}
+
+/*
+ * === Test 9: intrusive reference counting ===
+ *
+ * std::shared_ptr<Resource> ptr(new Resource) in Test 6 makes two allocations,
+ * the Resource and the control block holding the counts. std::make_shared
+ * merges them into one, but the pointer is still two words and the counts
+ * are still outside of Resource's own members.
+ *
+ * IntrusivePtr(intrusive_ptr.h) keeps the count inside the object, which
+ * derives from RefCounted<Counter>:
+ *   - one allocation, one-word pointer
+ *   - the count shares the cache line with the object's data
+ *   - PlainRefCount drops the atomic RMW for single-threaded objects
+ *
+ * Each benchmark below creates/copies/destroys count pointers, ns per pointer.
+ *
+ * NOTE:
+ *   libstdc++ skips the atomic instructions of std::shared_ptr while the
+ *   program has not started any thread, so its copy looks cheaper here than
+ *   in a multi-threaded program. Build with -DCMAKE_BUILD_TYPE=Release for
+ *   meaningful numbers.
+ */
+namespace Test9
+{
+    class Resource
+    {
+    public:
+        int m_value[4];
+        Resource() : m_value() { }
+    };
+
+    template <class Counter>
+    class CountedResource : public RefCounted<Counter>
+    {
+    public:
+        int m_value[4];
+        CountedResource() : m_value() { }
+    };
+
+    void sp_intrusive_ptr(void)
+    {
+        IntrusivePtr<CountedResource<AtomicRefCount> > ptr1 =
+            makeIntrusive<CountedResource<AtomicRefCount> >();
+        {
+            IntrusivePtr<CountedResource<AtomicRefCount> > ptr2(ptr1);
+            std::cout << "ptr1 and ptr2 share the object, count " << ptr1.useCount() << "\n";
+
+            // the count is in the object, so a raw pointer can be shared again safely
+            // (unlike std::shared_ptr<Resource>(res) twice in Test 6)
+            IntrusivePtr<CountedResource<AtomicRefCount> > ptr3(ptr2.get());
+            std::cout << "ptr3 from the raw pointer, count " << ptr1.useCount() << "\n";
+        }
+        std::cout << "ptr2 and ptr3 are gone, count " << ptr1.useCount() << "\n";
+
+        std::cout << "sizeof(std::shared_ptr<Resource>) = " << sizeof(std::shared_ptr<Resource>) << "\n";
+        std::cout << "sizeof(IntrusivePtr<Resource>)    = "
+                  << sizeof(IntrusivePtr<CountedResource<AtomicRefCount> >) << "\n";
+    }
+
+    template <class Ptr, class Make>
+    void benchPtr(const char *name, int count, Make make)
+    {
+        std::vector<Ptr> v(count);
+
+        // creation: count objects
+        Timer t;
+        for (int i = 0; i < count; ++i)
+            v[i] = make();
+        double create = t.elapsed() * 1e9 / count;
+
+        // destruction: drop the last reference of each object
+        t.reset();
+        v.clear();
+        double destroy = t.elapsed() * 1e9 / count;
+
+        // copy: count references to one object
+        Ptr p = make();
+        v.resize(count);
+        t.reset();
+        for (int i = 0; i < count; ++i)
+            v[i] = p;
+        double copy = t.elapsed() * 1e9 / count;
+
+        // release the copies, the object is still alive
+        t.reset();
+        v.clear();
+        double release = t.elapsed() * 1e9 / count;
+
+        std::cout << name << "create " << create << ", destroy " << destroy
+                  << ", copy " << copy << ", release " << release << " ns\n";
+    }
+
+    void sp_intrusive_bench(void)
+    {
+        const int count = 1000000;
+
+        typedef CountedResource<AtomicRefCount> AtomicResource;
+        typedef CountedResource<PlainRefCount> PlainResource;
+
+        benchPtr<std::shared_ptr<Resource> >("shared_ptr(new)        : ", count,
+                [] { return std::shared_ptr<Resource>(new Resource); });
+        benchPtr<std::shared_ptr<Resource> >("make_shared            : ", count,
+                [] { return std::make_shared<Resource>(); });
+        benchPtr<IntrusivePtr<AtomicResource> >("IntrusivePtr(atomic)   : ", count,
+                [] { return makeIntrusive<AtomicResource>(); });
+        benchPtr<IntrusivePtr<PlainResource> >("IntrusivePtr(plain)    : ", count,
+                [] { return makeIntrusive<PlainResource>(); });
+
+        // 4 pointers x create/destroy/copy/release, for LEARNCPP_PERF
+        PerfCounters::setOperations(4L * 4 * count);
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< intrusive pointer >>>\n";
+        sp_intrusive_ptr();
+
+        std::cout << "\n<<< shared_ptr vs intrusive pointer >>>\n";
+        sp_intrusive_bench();
+    }
+}
+
+/*
+ * === Test 10: non-atomic local_shared_ptr ===
+ *
+ * Test 7's Person graph never leaves its thread, but std::shared_ptr and
+ * std::weak_ptr::lock() always update the counts atomically.
+ * local_shared_ptr/local_weak_ptr(local_shared_ptr.h) have the same API with
+ * plain integer counts. Build with -DCMAKE_BUILD_TYPE=Debug to assert when
+ * they are touched by another thread.
+ *
+ * Benchmark: walk a linked graph where every node owns the next one and
+ * observes a partner by a weak pointer(like Person::m_partner). Each step
+ * copies a shared pointer and locks a weak pointer.
+ *
+ * NOTE:
+ *   libstdc++ only uses atomic counts after the first thread is created, so
+ *   the benchmark starts and joins a thread first, as any real multi-threaded
+ *   program would have done.
+ */
+namespace Test10
+{
+    class Person
+    {
+        std::string m_name;
+        local_weak_ptr<Person> m_partner;
+
+    public:
+        Person(const std::string &name) : m_name(name)
+        {
+            std::cout << m_name << " created\n";
+        }
+        ~Person()
+        {
+            std::cout << m_name << " destroyed\n";
+        }
+
+        friend bool partnerUp(local_shared_ptr<Person> &p1, local_shared_ptr<Person> &p2)
+        {
+            if (!p1 || !p2)
+                return false;
+
+            p1->m_partner = p2;
+            p2->m_partner = p1;
+
+            std::cout << p1->m_name << " is now partnered with " << p2->m_name << "\n";
+
+            return true;
+        }
+
+        const local_shared_ptr<Person> getPartner() const { return m_partner.lock(); }
+
+        const std::string& getName() const { return m_name; }
+    };
+
+    void sp_local_shared_ptr(void)
+    {
+        auto lucy = make_local_shared<Person>("Lucy");
+        auto ricky = make_local_shared<Person>("Ricky");
+
+        partnerUp(lucy, ricky);
+
+        auto partner = ricky->getPartner();
+        std::cout << ricky->getName() << "'s partner is: " << partner->getName() << '\n';
+
+        local_weak_ptr<Person> weak(lucy);
+        partner.reset();
+        lucy.reset();
+        std::cout << "Lucy is " << (weak.expired() ? "expired\n" : "alive\n");
+
+        // the last weak reference is released while the object is destroyed
+        std::cout << "\nA Person partnered with itself\n";
+        auto narcissus = make_local_shared<Person>("Narcissus");
+        partnerUp(narcissus, narcissus);
+        narcissus.reset();
+
+        local_shared_ptr<Person> echo(new Person("Echo"));
+        partnerUp(echo, echo);
+        echo.reset();
+    }
+
+    template <template <class> class Shared, template <class> class Weak>
+    class Node
+    {
+    public:
+        Shared<Node> m_next;
+        Weak<Node> m_partner;
+        long m_value;
+
+        Node(long value) : m_value(value) { }
+    };
+
+    template <template <class> class Shared, template <class> class Weak, class Make>
+    void benchGraph(const char *name, int count, int rounds, Make make)
+    {
+        typedef Node<Shared, Weak> node_t;
+
+        Timer t;
+        std::vector<Shared<node_t> > nodes;
+        nodes.reserve(count);
+        for (int i = 0; i < count; ++i)
+            nodes.push_back(make(i));
+        for (int i = 0; i < count; ++i) {
+            if (i + 1 < count)
+                nodes[i]->m_next = nodes[i + 1];
+            nodes[i]->m_partner = nodes[(i + count / 2) % count];
+        }
+        Shared<node_t> head = nodes[0];
+        nodes.clear();
+        double build = t.elapsed() * 1e3;
+
+        t.reset();
+        long sum = 0;
+        for (int r = 0; r < rounds; ++r) {
+            Shared<node_t> p = head;
+            while (p) {
+                Shared<node_t> partner = p->m_partner.lock();
+                sum += partner->m_value;
+                p = p->m_next;
+            }
+        }
+        double walk = t.elapsed() * 1e9 / (static_cast<double>(count) * rounds);
+
+        // NOTE: destroying a long chain recursively may overflow the stack,
+        //       so cut it from the head
+        t.reset();
+        while (head)
+            head = head->m_next;
+        double destroy = t.elapsed() * 1e3;
+
+        std::cout << name << "build " << build << " ms, walk " << walk
+                  << " ns/node, destroy " << destroy << " ms (sum " << sum << ")\n";
+    }
+
+    std::shared_ptr<Node<std::shared_ptr, std::weak_ptr> > makeStd(long value)
+    {
+        return std::make_shared<Node<std::shared_ptr, std::weak_ptr> >(value);
+    }
+
+    local_shared_ptr<Node<local_shared_ptr, local_weak_ptr> > makeLocal(long value)
+    {
+        return make_local_shared<Node<local_shared_ptr, local_weak_ptr> >(value);
+    }
+
+    void sp_local_bench(void)
+    {
+        std::thread([] { }).join(); // switch libstdc++ to atomic counts
+
+        const int count = 100000;
+        const int rounds = 20;
+
+        benchGraph<std::shared_ptr, std::weak_ptr>("shared_ptr/weak_ptr             : ",
+                count, rounds, makeStd);
+        benchGraph<local_shared_ptr, local_weak_ptr>("local_shared_ptr/local_weak_ptr : ",
+                count, rounds, makeLocal);
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< local_shared_ptr and local_weak_ptr >>>\n";
+        sp_local_shared_ptr();
+
+        std::cout << "\n<<< graph traversal >>>\n";
+        sp_local_bench();
+    }
+}
+
+/*
+ * === Test 11: object pool with recycling deleters ===
+ *
+ * Test 5 allocates every Resource by new and frees it when its
+ * std::unique_ptr dies. ObjectPool(object_pool.h) keeps the std::unique_ptr
+ * interface, but its deleter returns the object to a thread_local free list:
+ *   ObjectPool<T>:       destruct on release, construct on acquire, the
+ *                        memory is recycled
+ *   ObjectPool<T, true>: reset() on release, the object itself is recycled,
+ *                        no construction or destruction at all
+ *
+ * Benchmark: a request-like object(id + 256-byte payload) is acquired,
+ * touched and released count times, in batches of 64 live objects.
+ */
+namespace Test11
+{
+    class Resource
+    {
+    private:
+        int m_value;
+    public:
+        Resource(int value = 0)
+            : m_value(value)
+        {
+            std::cout << "Resource " << m_value << " acquired\n";
+        }
+        ~Resource() { std::cout << "Resource " << m_value << " destroyed\n"; }
+        void reset() { std::cout << "Resource " << m_value << " reset\n"; }
+        int getValue() const { return m_value; }
+    };
+
+    void sp_object_pool(void)
+    {
+        std::cout << "ObjectPool<Resource>:\n";
+        {
+            ObjectPool<Resource>::Ptr res1 = ObjectPool<Resource>::acquire(1);
+        } // destroyed, the memory goes to the free list
+        {
+            ObjectPool<Resource>::Ptr res2 = ObjectPool<Resource>::acquire(2);
+            std::cout << "free list: " << ObjectPool<Resource>::freeCount() << "\n";
+        }
+
+        std::cout << "ObjectPool<Resource, true>:\n";
+        {
+            ObjectPool<Resource, true>::Ptr res3 = ObjectPool<Resource, true>::acquire(3);
+        } // reset, the object goes to the free list
+        {
+            // no construction, we get Resource 3 again
+            ObjectPool<Resource, true>::Ptr res4 = ObjectPool<Resource, true>::acquire(4);
+            std::cout << "got Resource " << res4->getValue() << " back\n";
+        }
+        std::cout << "sizeof(ObjectPool<Resource>::Ptr) = "
+                  << sizeof(ObjectPool<Resource>::Ptr) << "\n";
+    }
+
+    class Request
+    {
+    public:
+        int m_id;
+        char m_payload[256];
+
+        Request(int id = 0) : m_id(id) { m_payload[0] = 0; }
+        void reset() { m_id = 0; m_payload[0] = 0; }
+    };
+
+    const int BATCH = 64;
+
+    // acquire BATCH objects, touch them and release them, count times in total
+    template <class Ptr, class Make>
+    void benchChurn(const char *name, int count, Make make)
+    {
+        Ptr batch[BATCH];
+        long sum = 0;
+
+        Timer t;
+        for (int i = 0; i < count; i += BATCH) {
+            for (int j = 0; j < BATCH; ++j) {
+                batch[j] = make(i + j);
+                batch[j]->m_payload[0] = static_cast<char>(j);
+            }
+            for (int j = 0; j < BATCH; ++j) {
+                sum += batch[j]->m_id;
+                batch[j].reset();
+            }
+        }
+        double ns = t.elapsed() * 1e9 / count;
+
+        std::cout << name << ns << " ns per object (sum " << sum << ")\n";
+    }
+
+    struct DeleteRequest
+    {
+        void operator()(Request *req) const { delete req; }
+    };
+
+    void sp_pool_bench(void)
+    {
+        const int count = 4000000;
+
+        benchChurn<std::unique_ptr<Request, DeleteRequest> >("new/delete           : ", count,
+                [](int id) { return std::unique_ptr<Request, DeleteRequest>(new Request(id)); });
+        benchChurn<std::unique_ptr<Request> >("std::make_unique     : ", count,
+                [](int id) { return std::make_unique<Request>(id); });
+        benchChurn<ObjectPool<Request>::Ptr>("ObjectPool           : ", count,
+                [](int id) { return ObjectPool<Request>::acquire(id); });
+        benchChurn<ObjectPool<Request, true>::Ptr>("ObjectPool(reuse)    : ", count,
+                [](int id) {
+                    // a recycled object keeps its old state, set it after acquire()
+                    ObjectPool<Request, true>::Ptr req = ObjectPool<Request, true>::acquire();
+                    req->m_id = id;
+                    return req;
+                });
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< object pool >>>\n";
+        sp_object_pool();
+
+        std::cout << "\n<<< new/delete vs object pool >>>\n";
+        sp_pool_bench();
+    }
+}
+
+/*
+ * === Test 12: publish snapshots with AtomicSharedPtr ===
+ *
+ * A read-mostly config is published as a shared snapshot: the writer builds
+ * a new one and swaps the pointer, readers take a reference to the current
+ * one and keep using it even after it's replaced.
+ *
+ * Swapping a std::shared_ptr needs a mutex(or std::atomic_load/atomic_store,
+ * a spinlock inside libstdc++), so readers block each other and the writer.
+ * AtomicSharedPtr(atomic_shared_ptr.h) loads with a single fetch_add.
+ *
+ * Benchmark: 1 writer publishes a new Config continuously, N readers load
+ * the current one and read it, for DURATION_MS. Reports million loads/sec.
+ */
+namespace Test12
+{
+    class Config : public RefCounted<AtomicRefCount>
+    {
+    public:
+        static std::atomic<long> s_live;
+
+        long m_version;
+        long m_values[8];
+
+        Config(long version) : m_version(version)
+        {
+            for (int i = 0; i < 8; ++i)
+                m_values[i] = version;
+            ++s_live;
+        }
+        ~Config() { --s_live; }
+
+        // a torn or freed snapshot would break it
+        bool isValid() const
+        {
+            for (int i = 0; i < 8; ++i)
+                if (m_values[i] != m_version)
+                    return false;
+            return true;
+        }
+    };
+
+    std::atomic<long> Config::s_live(0);
+
+    void sp_atomic_shared_ptr(void)
+    {
+        AtomicSharedPtr<Config> current(makeIntrusive<Config>(1));
+        std::cout << "lock free: " << (current.isLockFree() ? "yes\n" : "no\n");
+
+        IntrusivePtr<Config> mine = current.load();
+        current.store(makeIntrusive<Config>(2));
+        std::cout << "I still use version " << mine->m_version
+                  << ", published version " << current.load()->m_version << "\n";
+        std::cout << "live configs: " << Config::s_live << "\n";
+
+        mine.reset();
+        std::cout << "release the old one, live configs: " << Config::s_live << "\n";
+    }
+
+    class MutexPublisher
+    {
+        std::mutex m_lock;
+        std::shared_ptr<Config> m_current;
+    public:
+        MutexPublisher() : m_current(std::make_shared<Config>(0)) { }
+
+        std::shared_ptr<Config> load()
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            return m_current;
+        }
+
+        void store(long version)
+        {
+            std::shared_ptr<Config> next = std::make_shared<Config>(version);
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_current.swap(next);
+        } // the old one is released out of the lock
+    };
+
+    class AtomicLoadPublisher
+    {
+        std::shared_ptr<Config> m_current;
+    public:
+        AtomicLoadPublisher() : m_current(std::make_shared<Config>(0)) { }
+
+        std::shared_ptr<Config> load() { return std::atomic_load(&m_current); }
+        void store(long version) { std::atomic_store(&m_current, std::make_shared<Config>(version)); }
+    };
+
+    class AtomicSharedPublisher
+    {
+        AtomicSharedPtr<Config> m_current;
+    public:
+        AtomicSharedPublisher() : m_current(makeIntrusive<Config>(0)) { }
+
+        IntrusivePtr<Config> load() { return m_current.load(); }
+        void store(long version) { m_current.store(makeIntrusive<Config>(version)); }
+    };
+
+    const int DURATION_MS = 200;
+
+    template <class Publisher>
+    void benchPublish(const char *name, int readers)
+    {
+        Publisher publisher;
+        std::atomic<bool> stop(false);
+        std::atomic<long> loads(0);
+        std::atomic<long> invalid(0);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < readers; ++i) {
+            threads.push_back(std::thread([&] {
+                long count = 0;
+                long bad = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    auto config = publisher.load();
+                    if (!config->isValid())
+                        ++bad;
+                    ++count;
+                }
+                loads += count;
+                invalid += bad;
+            }));
+        }
+
+        std::thread writer([&] {
+            long version = 1;
+            while (!stop.load(std::memory_order_relaxed)) {
+                publisher.store(version++);
+                std::this_thread::yield();
+            }
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(DURATION_MS));
+        stop = true;
+        writer.join();
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+
+        std::cout << name << readers << " readers: "
+                  << loads * 1e-3 / DURATION_MS << " M loads/sec";
+        if (invalid)
+            std::cout << ", " << invalid << " INVALID snapshots";
+        std::cout << "\n";
+    }
+
+    void sp_publish_bench(void)
+    {
+        int readerCounts[] = { 1, 2, 4 };
+
+        for (int readers : readerCounts) {
+            benchPublish<MutexPublisher>("mutex + shared_ptr      , ", readers);
+            benchPublish<AtomicLoadPublisher>("std::atomic_load        , ", readers);
+            benchPublish<AtomicSharedPublisher>("AtomicSharedPtr         , ", readers);
+        }
+        std::cout << "live configs after all: " << Config::s_live << "\n";
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< AtomicSharedPtr >>>\n";
+        sp_atomic_shared_ptr();
+
+        std::cout << "\n<<< 1 writer, N readers >>>\n";
+        sp_publish_bench();
+    }
+}
+
+/*
+ * === Test 13: generational handles instead of shared_ptr/weak_ptr ===
+ *
+ * Test 7 owns each Person by a std::shared_ptr and breaks the cycle with a
+ * std::weak_ptr partner, every getPartner() locks it(atomic increment and
+ * decrement), and every Person is a separate heap allocation.
+ *
+ * With SlotMap(slot_map.h) the map owns all Persons in one vector, a partner
+ * is a SlotHandle. Resolving it is an index and a generation compare, an
+ * erased partner resolves to nullptr, like an expired std::weak_ptr.
+ *
+ * Benchmark: the next/partner graph of Test 10, built and walked with
+ * shared_ptr/weak_ptr and with SlotMap handles.
+ */
+namespace Test13
+{
+    class Person
+    {
+        std::string m_name;
+        SlotHandle m_partner;
+
+    public:
+        Person(const std::string &name) : m_name(name) { }
+
+        friend bool partnerUp(SlotMap<Person> &people, SlotHandle h1, SlotHandle h2)
+        {
+            Person *p1 = people.get(h1);
+            Person *p2 = people.get(h2);
+            if (!p1 || !p2)
+                return false;
+
+            p1->m_partner = h2;
+            p2->m_partner = h1;
+
+            std::cout << p1->m_name << " is now partnered with " << p2->m_name << "\n";
+
+            return true;
+        }
+
+        // NOTE: nullptr if the partner has been erased
+        Person* getPartner(SlotMap<Person> &people) const { return people.get(m_partner); }
+
+        const std::string& getName() const { return m_name; }
+    };
+
+    void sp_slot_map(void)
+    {
+        SlotMap<Person> people;
+
+        SlotHandle lucy = people.insert("Lucy");
+        SlotHandle ricky = people.insert("Ricky");
+
+        partnerUp(people, lucy, ricky);
+
+        Person *partner = people.get(ricky)->getPartner(people);
+        std::cout << people.get(ricky)->getName() << "'s partner is: " << partner->getName() << '\n';
+
+        people.erase(lucy);
+        std::cout << "Lucy is erased, Ricky's partner is "
+                  << (people.get(ricky)->getPartner(people) ? "alive\n" : "gone\n");
+
+        // the slot is reused, but the old handle has an old generation
+        SlotHandle ethel = people.insert("Ethel");
+        std::cout << "Ethel takes Lucy's slot " << ethel.m_index << ", Lucy's handle is "
+                  << (people.contains(lucy) ? "valid\n" : "stale\n");
+    }
+
+    class SlotNode
+    {
+    public:
+        SlotHandle m_next;
+        SlotHandle m_partner;
+        long m_value;
+
+        SlotNode(long value) : m_value(value) { }
+    };
+
+    void benchSlotMap(int count, int rounds)
+    {
+        Timer t;
+        SlotMap<SlotNode> nodes;
+        std::vector<SlotHandle> handles;
+        nodes.reserve(count);
+        handles.reserve(count);
+        for (int i = 0; i < count; ++i)
+            handles.push_back(nodes.insert(i));
+        for (int i = 0; i < count; ++i) {
+            SlotNode *node = nodes.get(handles[i]);
+            if (i + 1 < count)
+                node->m_next = handles[i + 1];
+            node->m_partner = handles[(i + count / 2) % count];
+        }
+        SlotHandle head = handles[0];
+        double build = t.elapsed() * 1e3;
+
+        t.reset();
+        long sum = 0;
+        for (int r = 0; r < rounds; ++r) {
+            SlotNode *p = nodes.get(head);
+            while (p) {
+                sum += nodes.get(p->m_partner)->m_value;
+                p = nodes.get(p->m_next);
+            }
+        }
+        double walk = t.elapsed() * 1e9 / (static_cast<double>(count) * rounds);
+
+        std::cout << "SlotMap handles     : build " << build << " ms, walk "
+                  << walk << " ns/node (sum " << sum << ")\n";
+    }
+
+    void sp_slot_map_bench(void)
+    {
+        std::thread([] { }).join(); // switch libstdc++ to atomic counts, see Test 10
+
+        const int count = 100000;
+        const int rounds = 20;
+
+        Test10::benchGraph<std::shared_ptr, std::weak_ptr>("shared_ptr/weak_ptr : ",
+                count, rounds, Test10::makeStd);
+        benchSlotMap(count, rounds);
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< SlotMap handles >>>\n";
+        sp_slot_map();
+
+        std::cout << "\n<<< graph build and traversal >>>\n";
+        sp_slot_map_bench();
+    }
+}
+
+REGISTER_TEST(1, "smart pointer and move semantics");
+REGISTER_TEST(2, "r-value");
+REGISTER_TEST(3, "move constructor and move assignment for r-value");
+REGISTER_TEST(4, "std::move for l-value");
+REGISTER_TEST(5, "std::unique_ptr");
+REGISTER_TEST(6, "std::shared_ptr");
+REGISTER_TEST(7, "std::weak_ptr");
+REGISTER_TEST(8, "noexcept move and std::move_if_noexcept");
+REGISTER_TEST(9, "intrusive reference counting");
+REGISTER_TEST(10, "non-atomic local_shared_ptr");
+REGISTER_TEST(11, "object pool with recycling deleters");
+REGISTER_TEST(12, "publish snapshots with AtomicSharedPtr");
+REGISTER_TEST(13, "generational handles instead of shared_ptr/weak_ptr");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // smart pointer and move semantics
-    run(2, &(Test2::fn)); // r-value
-    run(3, &(Test3::fn)); // move constructor and move assignment for r-value
-    run(4, &(Test4::fn)); // std::move for l-value
-    run(5, &(Test5::fn)); // std::unique_ptr
-    run(6, &(Test6::fn)); // std::shared_ptr
-    run(7, &(Test7::fn)); // std::weak_ptr
+    return runTests(argc, argv);
 }
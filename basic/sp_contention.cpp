@@ -0,0 +1,337 @@
+#include "global.h"
+#include "intrusive_ptr.h"
+#include "trace.h"
+#include <memory>       // std::shared_ptr, std::make_shared
+#include <thread>       // std::thread
+#include <atomic>       // std::atomic
+#include <new>          // placement new
+#include <pthread.h>    // pthread_setaffinity_np()
+#include <sched.h>      // cpu_set_t
+
+/*
+ * Reference count contention across cores
+ *
+ * Copying a std::shared_ptr increments the count with a locked RMW, the
+ * core has to own the count's cache line exclusively. If other cores update
+ * the same line, it ping-pongs between them and the copy gets slower with
+ * every core added, although no data is shared logically.
+ *
+ * Each thread copies and destroys a pointer ITERATIONS times:
+ *   Test 1: all threads copy the same object(true sharing)
+ *   Test 2: every thread has its own object, allocated by itself
+ *   Test 3: every thread has its own object, but the objects are allocated
+ *           back-to-back, so neighbours' counts share a cache line(false sharing)
+ *
+ * Pointers:
+ *   shared_ptr(new): object and control block allocated separately
+ *   make_shared:     control block and object in one allocation
+ *   IntrusivePtr:    count inside the object, atomic(intrusive_ptr.h)
+ *   non-atomic:      IntrusivePtr with PlainRefCount, only valid when the
+ *                    object is not shared, skipped in Test 1
+ *
+ * Reports million copies/sec of all threads for 1, 2, 4, ... threads(each
+ * pinned to a core), and the speedup over 1 thread. Ideal scaling is N for
+ * N threads, as long as there are N cores.
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+const int ITERATIONS = 2000000;
+
+enum Pattern
+{
+    PATTERN_SHARED,
+    PATTERN_PER_THREAD,
+    PATTERN_NEIGHBOURS,
+};
+
+// A bump allocator: objects allocated from it are next to each other.
+// Not thread-safe, used by the main thread before the workers start.
+class Arena
+{
+private:
+    char *m_buf;
+    size_t m_size;
+    size_t m_used;
+
+public:
+    Arena(size_t size) : m_buf(new char[size]), m_size(size), m_used(0) { }
+    ~Arena() { delete [] m_buf; }
+
+    Arena(const Arena &) = delete;
+    Arena& operator=(const Arena &) = delete;
+
+    void* allocate(size_t size, size_t align)
+    {
+        size_t start = (m_used + align - 1) / align * align;
+        assert(start + size <= m_size);
+        m_used = start + size;
+        return m_buf + start;
+    }
+};
+
+// std allocator on top of Arena, deallocate() does nothing
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    Arena *m_arena;
+
+    ArenaAllocator(Arena *arena) : m_arena(arena) { }
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &a) : m_arena(a.m_arena) { }
+
+    T* allocate(size_t n) { return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) { }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &a) const { return m_arena == a.m_arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &a) const { return m_arena != a.m_arena; }
+};
+
+class Resource
+{
+public:
+    int m_value[4];
+    Resource() : m_value() { }
+};
+
+template <class Counter>
+class CountedResource : public RefCounted<Counter>
+{
+public:
+    int m_value[4];
+    CountedResource() : m_value() { }
+};
+
+/*
+ * A pointer kind: make() creates the object a thread copies, from the arena
+ * if it's given. release()/releaseFromArena() drops it at the end.
+ */
+class SharedNew
+{
+public:
+    typedef std::shared_ptr<Resource> ptr_t;
+    static const bool THREAD_SAFE = true;
+
+    struct NoDelete
+    {
+        void operator()(Resource *) const { }
+    };
+
+    static ptr_t make(Arena *arena)
+    {
+        if (!arena)
+            return ptr_t(new Resource);
+        // object and control block, next to each other in the arena
+        void *mem = arena->allocate(sizeof(Resource), alignof(Resource));
+        return ptr_t(new (mem) Resource, NoDelete(), ArenaAllocator<Resource>(arena));
+    }
+
+    static void release(ptr_t &p) { p.reset(); }
+    static void releaseFromArena(ptr_t &p) { p.reset(); }
+};
+
+class MakeShared
+{
+public:
+    typedef std::shared_ptr<Resource> ptr_t;
+    static const bool THREAD_SAFE = true;
+
+    static ptr_t make(Arena *arena)
+    {
+        if (!arena)
+            return std::make_shared<Resource>();
+        return std::allocate_shared<Resource>(ArenaAllocator<Resource>(arena));
+    }
+
+    static void release(ptr_t &p) { p.reset(); }
+    static void releaseFromArena(ptr_t &p) { p.reset(); }
+};
+
+template <class Counter, bool ThreadSafe>
+class Intrusive
+{
+public:
+    typedef CountedResource<Counter> object_t;
+    typedef IntrusivePtr<object_t> ptr_t;
+    static const bool THREAD_SAFE = ThreadSafe;
+
+    static ptr_t make(Arena *arena)
+    {
+        if (!arena)
+            return makeIntrusive<object_t>();
+        void *mem = arena->allocate(sizeof(object_t), alignof(object_t));
+        return ptr_t(new (mem) object_t);
+    }
+
+    static void release(ptr_t &p) { p.reset(); }
+
+    // the arena owns the memory, don't let IntrusivePtr delete it
+    static void releaseFromArena(ptr_t &p)
+    {
+        object_t *obj = p.detach();
+        obj->~object_t();
+    }
+};
+
+void pinToCore(int i)
+{
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    if (cores <= 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(i % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set); // best effort
+}
+
+// copy and destroy ITERATIONS times on each of threads threads,
+// returns million copies/sec of all threads
+template <class Kind>
+double runThreads(int threads, Pattern pattern)
+{
+    typedef typename Kind::ptr_t ptr_t;
+
+    std::vector<ptr_t> sources(threads);
+    Arena arena(4096 + threads * 256);
+
+    if (pattern == PATTERN_SHARED) {
+        ptr_t p = Kind::make(nullptr);
+        for (int i = 0; i < threads; ++i)
+            sources[i] = p;
+    } else if (pattern == PATTERN_NEIGHBOURS) {
+        for (int i = 0; i < threads; ++i)
+            sources[i] = Kind::make(&arena);
+    } // PATTERN_PER_THREAD: made by each thread
+
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(std::thread([&, i] {
+            pinToCore(i);
+            if (pattern == PATTERN_PER_THREAD)
+                sources[i] = Kind::make(nullptr);
+            const ptr_t &src = sources[i];
+
+            ++ready;
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            TRACE_SCOPE("copy loop");
+            for (int n = 0; n < ITERATIONS; ++n) {
+                ptr_t copy(src);
+                doNotOptimize(copy);
+            }
+        }));
+    }
+
+    while (ready.load() < threads)
+        std::this_thread::yield();
+
+    Timer t;
+    go.store(true, std::memory_order_release);
+    for (int i = 0; i < threads; ++i)
+        workers[i].join();
+    double seconds = t.elapsed();
+
+    for (int i = 0; i < threads; ++i) {
+        if (pattern == PATTERN_NEIGHBOURS)
+            Kind::releaseFromArena(sources[i]);
+        else
+            Kind::release(sources[i]);
+    }
+
+    return static_cast<double>(threads) * ITERATIONS / seconds * 1e-6;
+}
+
+std::vector<int> threadCounts(void)
+{
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    int max = cores > 4 ? cores : 4;
+
+    std::vector<int> counts;
+    for (int n = 1; n <= max; n *= 2)
+        counts.push_back(n);
+    if (counts.back() != max)
+        counts.push_back(max);
+    return counts;
+}
+
+template <class Kind>
+void sweep(const char *name, Pattern pattern)
+{
+    std::cout << name;
+    if (pattern == PATTERN_SHARED && !Kind::THREAD_SAFE) {
+        std::cout << "(skipped, not thread-safe)\n";
+        return;
+    }
+
+    std::vector<int> counts = threadCounts();
+    double base = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        double rate = runThreads<Kind>(counts[i], pattern);
+        if (i == 0)
+            base = rate;
+        std::cout << counts[i] << "T " << rate << " (x" << rate / base << ")  ";
+    }
+    std::cout << "\n";
+}
+
+void sweepAll(Pattern pattern)
+{
+    std::cout << "M copies/sec, (speedup over 1 thread), "
+              << std::thread::hardware_concurrency() << " cores\n";
+    sweep<SharedNew>("shared_ptr(new)  : ", pattern);
+    sweep<MakeShared>("make_shared      : ", pattern);
+    sweep<Intrusive<AtomicRefCount, true> >("IntrusivePtr     : ", pattern);
+    sweep<Intrusive<PlainRefCount, false> >("non-atomic       : ", pattern);
+}
+
+/*
+ * === Test 1: all threads copy one object ===
+ */
+namespace Test1
+{
+    void fn(void)
+    {
+        sweepAll(PATTERN_SHARED);
+    }
+}
+
+/*
+ * === Test 2: every thread copies its own object ===
+ */
+namespace Test2
+{
+    void fn(void)
+    {
+        sweepAll(PATTERN_PER_THREAD);
+    }
+}
+
+/*
+ * === Test 3: own objects, counts on neighbouring addresses ===
+ */
+namespace Test3
+{
+    void fn(void)
+    {
+        sweepAll(PATTERN_NEIGHBOURS);
+    }
+}
+
+REGISTER_TEST(1, "true sharing");
+REGISTER_TEST(2, "per-thread objects");
+REGISTER_TEST(3, "false sharing");
+
+int main(int argc, char *argv[])
+{
+    return runTests(argc, argv);
+}
@@ -315,12 +315,14 @@ namespace Test6
     }
 }
 
-int main()
+REGISTER_TEST(1, "string constructor");
+REGISTER_TEST(2, "string length and capacity");
+REGISTER_TEST(3, "string access and converting to C-style array");
+REGISTER_TEST(4, "string assign and swap");
+REGISTER_TEST(5, "string appending");
+REGISTER_TEST(6, "string inserting");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // string constructor
-    run(2, &(Test2::fn)); // string length and capacity
-    run(3, &(Test3::fn)); // string access and converting to C-style array
-    run(4, &(Test4::fn)); // string assign and swap
-    run(5, &(Test5::fn)); // string appending
-    run(6, &(Test6::fn)); // string inserting
+    return runTests(argc, argv);
 }
@@ -1,6 +1,8 @@
 #include "global.h"
 #include <string>
 #include <cstring>
+#include <utility>      // std::swap
+#include <type_traits>  // std::is_nothrow_move_constructible
 
 /*
  * === Test 1: function template ===
@@ -107,6 +109,50 @@ namespace Test1
             m_count = 0;
         }
 
+        // deep copy, otherwise two Arrays delete the same m_data
+        Array(const Array &a)
+            : m_data(nullptr), m_count(a.m_count)
+        {
+            if (m_count > 0) {
+                m_data = new T[m_count];
+                for (int i = 0; i < m_count; ++i)
+                    m_data[i] = a.m_data[i];
+            }
+        }
+
+        Array& operator=(const Array &a)
+        {
+            if (&a == this)
+                return *this;
+
+            Array tmp(a);
+            std::swap(m_data, tmp.m_data);
+            std::swap(m_count, tmp.m_count);
+            return *this;
+        }
+
+        // move never allocates, so mark it noexcept and std::vector will
+        // move Arrays instead of copying them when it grows
+        Array(Array &&a) noexcept
+            : m_data(a.m_data), m_count(a.m_count)
+        {
+            a.m_data = nullptr;
+            a.m_count = 0;
+        }
+
+        Array& operator=(Array &&a) noexcept
+        {
+            if (&a == this)
+                return *this;
+
+            delete [] m_data;
+            m_data = a.m_data;
+            m_count = a.m_count;
+            a.m_data = nullptr;
+            a.m_count = 0;
+            return *this;
+        }
+
         T& operator[] (int index)
         {
             //assert(index >= 0 && index < m_count);
@@ -121,6 +167,11 @@ namespace Test1
     // class name is Array<T>, not Array
     int Array<T>::getCount() { return m_count; }
 
+    static_assert(std::is_nothrow_move_constructible<Array<int> >::value,
+                  "Array move constructor must be noexcept");
+    static_assert(std::is_nothrow_move_assignable<Array<int> >::value,
+                  "Array move assignment must be noexcept");
+
     void template_class(void)
     {
         Array<int> intArray(8);
@@ -295,9 +346,11 @@ namespace Test3
     }
 };
 
-int main()
+REGISTER_TEST(1, "template function and class");
+REGISTER_TEST(2, "template and class specialization");
+REGISTER_TEST(3, "partial template function specialization");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // template function and class
-    run(2, &(Test2::fn)); // template and class specialization
-    run(3, &(Test3::fn)); // partial template function specialization
+    return runTests(argc, argv);
 }
@@ -0,0 +1,180 @@
+#include "test_runner.h"
+#include "global.h"
+#include "output_capture.h"
+#include "alloc_tracker.h"
+#include "bench.h"
+#include "perf_counters.h"
+#include "mem_usage.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <string.h>     // strcmp(), strstr()
+#include <stdlib.h>     // atoi()
+
+// a function local static: registrars run before main(), in any order
+static std::vector<TestRegistry::Entry>& registry()
+{
+    static std::vector<TestRegistry::Entry> s_entries;
+    return s_entries;
+}
+
+void TestRegistry::add(int i, const char *name, void (*fn)(void))
+{
+    Entry e = { i, name, fn };
+    registry().push_back(e);
+}
+
+std::vector<TestRegistry::Entry> TestRegistry::entries()
+{
+    std::vector<Entry> v = registry();
+    std::stable_sort(v.begin(), v.end(),
+                     [](const Entry &a, const Entry &b) { return a.m_number < b.m_number; });
+    return v;
+}
+
+static bool isNumber(const char *s)
+{
+    if (!*s)
+        return false;
+    for (; *s; ++s) {
+        if (*s < '0' || *s > '9')
+            return false;
+    }
+    return true;
+}
+
+static bool matches(const TestRegistry::Entry &e, const std::vector<const char*> &filters)
+{
+    if (filters.empty())
+        return true;
+
+    for (size_t i = 0; i < filters.size(); ++i) {
+        if (isNumber(filters[i]) ? atoi(filters[i]) == e.m_number
+                                 : strstr(e.m_name, filters[i]) != nullptr)
+            return true;
+    }
+    return false;
+}
+
+static void usage(const char *prog)
+{
+    std::cout << "usage: " << prog << " [-j N] [-l] [filter...]\n"
+              << "  -j N     run N tests at a time(default 1)\n"
+              << "  -l       list the tests\n"
+              << "  filter   a test number, or a part of test names\n";
+}
+
+static void runParallel(const std::vector<TestRegistry::Entry> &tests, int jobs)
+{
+    size_t count = tests.size();
+    std::vector<std::unique_ptr<std::stringbuf> > outputs;
+    for (size_t i = 0; i < count; ++i)
+        outputs.push_back(std::unique_ptr<std::stringbuf>(new std::stringbuf));
+
+    // written at thread exit, e.g. by thread_local destructors
+    std::vector<std::unique_ptr<std::stringbuf> > exitOutputs;
+    for (int w = 0; w < jobs; ++w)
+        exitOutputs.push_back(std::unique_ptr<std::stringbuf>(new std::stringbuf));
+
+    std::vector<bool> done(count, false);
+    std::mutex mutex;
+    std::condition_variable doneCond;
+    std::atomic<size_t> next(0);
+
+    OutputCapture::install();
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < jobs; ++w) {
+        workers.push_back(std::thread([&, w] {
+            OutputCapture::setThreadTarget(exitOutputs[w].get());
+            Trace::setThreadName(("worker " + std::to_string(w + 1)).c_str());
+            for (size_t i = next++; i < count; i = next++) {
+                {
+                    OutputCapture::Scope capture(outputs[i].get());
+                    run(tests[i].m_number, tests[i].m_fn);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                done[i] = true;
+                doneCond.notify_all();
+            }
+        }));
+    }
+
+    // print in order, each test as soon as the ones before it are done
+    for (size_t i = 0; i < count; ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            doneCond.wait(lock, [&] { return done[i]; });
+        }
+        std::cout << outputs[i]->str();
+        outputs[i].reset();
+    }
+
+    for (size_t w = 0; w < workers.size(); ++w)
+        workers[w].join();
+    for (size_t w = 0; w < exitOutputs.size(); ++w)
+        std::cout << exitOutputs[w]->str();
+
+    OutputCapture::uninstall();
+}
+
+int runTests(int argc, char *argv[])
+{
+    int jobs = 1;
+    bool list = false;
+    std::vector<const char*> filters;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && isNumber(argv[i] + 2)) {
+            jobs = atoi(argv[i] + 2);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            list = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            filters.push_back(argv[i]);
+        }
+    }
+
+    std::vector<TestRegistry::Entry> all = TestRegistry::entries();
+    std::vector<TestRegistry::Entry> tests;
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (matches(all[i], filters))
+            tests.push_back(all[i]);
+    }
+
+    if (list) {
+        for (size_t i = 0; i < tests.size(); ++i)
+            std::cout << tests[i].m_number << ": " << tests[i].m_name << "\n";
+        return 0;
+    }
+
+    if (jobs > 1 && (AllocTracker::isEnabled() || PerfCounters::isEnabled()
+                     || MemUsage::isEnabled() || Bench::isEnabled())) {
+        std::cout << "--- runner: measuring the whole process, -j " << jobs << " is ignored\n\n";
+        jobs = 1;
+    }
+    if (jobs > static_cast<int>(tests.size()))
+        jobs = static_cast<int>(tests.size());
+
+    Trace::setThreadName("main");
+
+    Timer t;
+    if (jobs <= 1) {
+        for (size_t i = 0; i < tests.size(); ++i)
+            run(tests[i].m_number, tests[i].m_fn);
+    } else {
+        runParallel(tests, jobs);
+        std::cout << "--- runner: " << tests.size() << " tests, " << jobs << " jobs, "
+                  << t.elapsed() << " seconds\n";
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef _TEST_RUNNER_H_
+#define _TEST_RUNNER_H_
+
+#include <vector>
+
+/*
+ * Test runner: tests register themselves, runTests() runs them by run()
+ *
+ *   namespace Test1 { void fn(void) { ... } }
+ *   namespace Test2 { void fn(void) { ... } }
+ *
+ *   REGISTER_TEST(1, "vector initialization");   // runs Test1::fn
+ *   REGISTER_TEST(2, "vector size");
+ *
+ *   int main(int argc, char *argv[])
+ *   {
+ *       return runTests(argc, argv);
+ *   }
+ *
+ * Command line:
+ *   ./vector [-j N] [-l] [filter...]
+ *     -j N     run N tests at a time(default 1)
+ *     -l       list the tests and exit
+ *     filter   a number selects that test, anything else the tests whose
+ *              name contains it, e.g. ./smart_pointer -j 4 shared_ptr 12
+ *
+ * With -j 1 the tests run one by one in the main thread, exactly like
+ * calling run() in order.
+ * With -j N each test's std::cout/std::cerr/std::clog go to its own buffer
+ * (OutputCapture), printed in test number order as soon as all tests before
+ * it are done. The wall time is printed at the end.
+ *
+ * NOTE:
+ *   - Tests running at a time compete for the cores, don't trust the
+ *     benchmarks they print. With LEARNCPP_BENCH, LEARNCPP_PERF,
+ *     LEARNCPP_MEM or ALLOC_TRACKER, which measure the whole process, -j is
+ *     ignored.
+ *   - Tests reading std::cin must run with -j 1.
+ */
+class TestRegistry
+{
+public:
+    struct Entry
+    {
+        int m_number;
+        const char *m_name;
+        void (*m_fn)(void);
+    };
+
+    static void add(int i, const char *name, void (*fn)(void));
+
+    // sorted by number
+    static std::vector<Entry> entries();
+};
+
+class TestRegistrar
+{
+public:
+    TestRegistrar(int i, const char *name, void (*fn)(void))
+    {
+        TestRegistry::add(i, name, fn);
+    }
+};
+
+#define REGISTER_TEST(i, name) \
+    static TestRegistrar s_registerTest##i(i, name, &(Test##i::fn))
+
+int runTests(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,169 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdlib.h>     // getenv()
+#include <unistd.h>     // getpid()
+
+struct Event
+{
+    const char *m_name;
+    int m_id;
+    int64_t m_begin;    // ns
+    int64_t m_end;
+};
+
+static const int CHUNK_SIZE = 1024;
+static const int CHUNKS = Trace::RING_SIZE / CHUNK_SIZE;
+
+/*
+ * Written by its thread only, read at exit.
+ * Allocated in chunks as they are needed, a short thread recording a few
+ * spans doesn't cost a whole ring. A chunk never moves, and is allocated
+ * before m_count publishes the spans in it.
+ */
+struct Ring
+{
+    Event *m_chunks[CHUNKS];
+    std::atomic<uint64_t> m_count;      // all spans recorded, m_count % RING_SIZE is next
+    int m_tid;
+    std::string m_threadName;
+
+    Ring(int tid) : m_chunks(), m_count(0), m_tid(tid) { }
+
+    ~Ring()
+    {
+        for (int i = 0; i < CHUNKS; ++i)
+            delete [] m_chunks[i];
+    }
+
+    Event& at(uint64_t k)
+    {
+        size_t index = k % Trace::RING_SIZE;
+        Event *&chunk = m_chunks[index / CHUNK_SIZE];
+        if (!chunk)
+            chunk = new Event[CHUNK_SIZE];
+        return chunk[index % CHUNK_SIZE];
+    }
+};
+
+static const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+
+bool Trace::s_enabled = getenv("LEARNCPP_TRACE") && *getenv("LEARNCPP_TRACE");
+
+static thread_local Ring *t_ring = nullptr;
+
+static void writeName(std::ostream &out, const char *name, int id)
+{
+    out << '"';
+    for (const char *c = name; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    if (id >= 0)
+        out << ' ' << id;
+    out << '"';
+}
+
+// owns the rings of all threads, writes them at exit
+class Rings
+{
+private:
+    std::mutex m_mutex;
+    std::vector<Ring*> m_rings;
+
+    void write(const char *path)
+    {
+        std::ofstream out(path);
+        int pid = static_cast<int>(getpid());
+        uint64_t dropped = 0;
+        bool first = true;
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"traceEvents\": [";
+        for (size_t r = 0; r < m_rings.size(); ++r) {
+            Ring *ring = m_rings[r];
+            uint64_t count = ring->m_count.load(std::memory_order_acquire);
+            uint64_t begin = count > Trace::RING_SIZE ? count - Trace::RING_SIZE : 0;
+            dropped += begin;
+
+            out << (first ? "\n" : ",\n")
+                << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+                << ", \"tid\": " << ring->m_tid << ", \"args\": {\"name\": ";
+            writeName(out, ring->m_threadName.c_str(), -1);
+            out << "}}";
+            first = false;
+
+            // complete events, "ts" and "dur" in us
+            for (uint64_t k = begin; k < count; ++k) {
+                const Event &e = ring->at(k);
+                out << ",\n  {\"name\": ";
+                writeName(out, e.m_name, e.m_id);
+                out << ", \"ph\": \"X\", \"pid\": " << pid << ", \"tid\": " << ring->m_tid
+                    << ", \"ts\": " << e.m_begin / 1000.0
+                    << ", \"dur\": " << (e.m_end - e.m_begin) / 1000.0 << "}";
+            }
+        }
+        out << "\n],\n\"displayTimeUnit\": \"ns\",\n"
+            << "\"otherData\": {\"dropped_spans\": " << dropped << "}}\n";
+    }
+
+public:
+    ~Rings()
+    {
+        const char *path = getenv("LEARNCPP_TRACE");
+        if (Trace::isEnabled() && path)
+            write(path);
+
+        for (size_t r = 0; r < m_rings.size(); ++r)
+            delete m_rings[r];
+    }
+
+    Ring* add()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Ring *ring = new Ring(static_cast<int>(m_rings.size()) + 1);
+        ring->m_threadName = "thread " + std::to_string(ring->m_tid);
+        m_rings.push_back(ring);
+        return ring;
+    }
+};
+
+static Rings s_rings;
+
+static Ring* threadRing()
+{
+    if (!t_ring)
+        t_ring = s_rings.add();
+    return t_ring;
+}
+
+int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - s_start).count();
+}
+
+void Trace::record(const char *name, int id, int64_t begin, int64_t end)
+{
+    Ring *ring = threadRing();
+    uint64_t count = ring->m_count.load(std::memory_order_relaxed);
+
+    Event &e = ring->at(count);
+    e.m_name = name;
+    e.m_id = id;
+    e.m_begin = begin;
+    e.m_end = end;
+    ring->m_count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::setThreadName(const char *name)
+{
+    if (isEnabled())
+        threadRing()->m_threadName = name;
+}
@@ -0,0 +1,80 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdint.h>
+
+/*
+ * Trace: timeline of scoped spans, in Chrome trace event JSON
+ *
+ * Enable by environment variable, the file is written when the program exits:
+ *   LEARNCPP_TRACE=trace.json ./smart_pointer -j 4
+ * then open it in https://ui.perfetto.dev or chrome://tracing.
+ *
+ *   void work()
+ *   {
+ *       TRACE_SCOPE("work");     // a span from here to the end of the scope
+ *       ...
+ *   }
+ *
+ * run() opens a span per test, "Test 3" etc., so every test binary has a
+ * timeline of its tests on the threads running them.
+ *
+ * How it works:
+ *   every thread records into its own ring buffer, only the thread writes it,
+ *   so recording takes no lock and no atomic RMW: two clock reads and a store.
+ *   A full ring overwrites its oldest spans, the file tells how many are lost.
+ *   The rings are kept after their threads exit and written at exit.
+ *
+ * NOTE:
+ *   - The name must outlive the program, e.g. a string literal.
+ *   - Disabled, a span costs a check of a flag.
+ *   - Spans of threads still running at exit may be incomplete.
+ */
+class Trace
+{
+private:
+    static bool s_enabled;
+
+public:
+    static const int RING_SIZE = 65536;     // spans per thread
+
+    // true if LEARNCPP_TRACE is set
+    static bool isEnabled() { return s_enabled; }
+
+    // ns since the start of the program
+    static int64_t now();
+
+    // a finished span of the calling thread, named "name id" if id >= 0
+    static void record(const char *name, int id, int64_t begin, int64_t end);
+
+    // name the calling thread on the timeline, e.g. "worker 1"
+    static void setThreadName(const char *name);
+};
+
+class TraceSpan
+{
+private:
+    const char *m_name;
+    int m_id;
+    int64_t m_begin;
+
+public:
+    explicit TraceSpan(const char *name, int id = -1)
+        : m_name(name), m_id(id), m_begin(Trace::isEnabled() ? Trace::now() : 0)
+    { }
+
+    ~TraceSpan()
+    {
+        if (Trace::isEnabled())
+            Trace::record(m_name, m_id, m_begin, Trace::now());
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan& operator=(const TraceSpan &) = delete;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+#endif
@@ -177,11 +177,13 @@ namespace Test5
     }
 }
 
-int main()
+REGISTER_TEST(1, "vector initialization");
+REGISTER_TEST(2, "vector size");
+REGISTER_TEST(3, "vector traversing");
+REGISTER_TEST(4, "vector insert");
+REGISTER_TEST(5, "vector access");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // vector initialization
-    run(2, &(Test2::fn)); // vector size
-    run(3, &(Test3::fn)); // vector traversing
-    run(4, &(Test4::fn)); // vector insert
-    run(5, &(Test5::fn)); // vector access
+    return runTests(argc, argv);
 }
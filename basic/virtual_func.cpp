@@ -1,5 +1,22 @@
 #include "global.h"
+#include "buffer.h"
+#include "casting.h"
+#include "crtp.h"
+#include "ecs.h"
+#include "error_log.h"
+#include "poly_collection.h"
+#include "poly_vector.h"
 #include <functional>
+#include <fstream>      // std::ofstream
+#include <sstream>      // std::ostringstream
+#include <algorithm>    // std::sort, std::shuffle
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937
+#include <typeinfo>     // typeid
+#include <variant>      // std::variant, std::visit
+#include <math.h>       // sqrt()
+#include <stdio.h>      // P_tmpdir
+#include <unistd.h>     // unlink()
 
 /*
  * overload(重载)
@@ -470,6 +487,46 @@ namespace Test5
         virtual const char* speak() { return Animal::speak(); }
     };
 
+    // Interface class: every function is virtual and must be implemented in
+    // derived classes, even if it returns 0 directly.
+    //
+    // We can derive FileErrorLog and ScreenErrorLog from IErrorLog,
+    // and resolve the Error handling in the same way regardless of input error
+    // class
+    //
+    // IErrorLog, FileErrorLog and ScreenErrorLog are in error_log.h
+    double mySqrt(double value, IErrorLog &log)
+    {
+        if (value < 0.0)
+        {
+            log.writeError("Tried to take square root of value less than 0");
+            return 0.0;
+        }
+        else
+            return sqrt(value);
+    }
+
+    void fn_interface(void)
+    {
+        ScreenErrorLog screen;
+        screen.openLog(nullptr);
+        std::cout << "mySqrt(16.0) = " << mySqrt(16.0, screen) << '\n';
+        std::cout << "mySqrt(-1.0) = " << mySqrt(-1.0, screen) << ", logged to stderr\n";
+        screen.closeLog();
+
+        std::string filename = std::string(P_tmpdir) + "/virtual_func_error.log";
+        unlink(filename.c_str());
+
+        FileErrorLog file;
+        file.openLog(filename.c_str());
+        mySqrt(-2.0, file);
+        mySqrt(-3.0, file);
+        file.closeLog();
+        std::cout << "mySqrt(-2.0) and mySqrt(-3.0) logged to " << filename << ", "
+                  << file.written() << " lines\n";
+        unlink(filename.c_str());
+    }
+
     void fn(void)
     {
         // Compiling error as Animal is an abstract base class
@@ -482,36 +539,10 @@ namespace Test5
         Dragonfly dfly("Sally");
         std::cout << "Create Dragonfly from Animal abstract base class\n";
         std::cout << dfly.getName() << " says " << dfly.speak() << '\n';
-    }
-
-    // Interface class: every function is virtual and must be implemented in
-    // derived classes, even if it returns 0 directly.
-    //
-    // We can derive FileErrorLog and ScreenErrorLog from IErrorLog,
-    // and resolve the Error handling in the same way regardless of input error
-    // class
-    //
-    // class IErrorLog
-    // {
-    // public:
-    //     virtual bool openLog(const char *filename) = 0;
-    //     virtual bool closeLog() = 0;
 
-    //     virtual bool writeError(const char *errorMessage) = 0;
-
-    //     virtual ~IErrorLog() {}; // make a virtual destructor in case we delete an IErrorLog pointer, so the proper derived destructor is called
-    // };
-    //
-    // double mySqrt(double value, IErrorLog &log)
-    //{
-    //    if (value < 0.0)
-    //    {
-    //        log.writeError("Tried to take square root of value less than 0");
-    //        return 0.0;
-    //    }
-    //    else
-    //        return sqrt(value);
-    //}
+        std::cout << "\n<<< interface class >>>\n";
+        fn_interface();
+    }
 }
 
 /*
@@ -536,6 +567,9 @@ namespace Test5
  *    class. But classes inheriting the virtual base still need access to it.
  *    the compiler creates a virtual table for each class directly inheriting
  *    the virtual class (Printer and Scanner), pointing to the most derived class.
+ * 5) PoweredDevice is at a different offset in a Scanner and in a Copier, so
+ *    Scanner's functions load the offset from the vtable on every access to
+ *    PoweredDevice's members, Test 18 measures it.
  */
 namespace Test6
 {
@@ -690,6 +724,20 @@ namespace Test7
                       << v[count].get().getValue() << "\n";
     }
 
+    // PolyVector(poly_vector.h) keeps the whole Derived, inline in one buffer,
+    // anonymous objects are fine, the vector owns its copies
+    void vf_poly_vector(void)
+    {
+        std::cout << "create a PolyVector<Base>\n";
+        PolyVector<Base> v;
+        v.push_back(Base(5));
+        v.push_back(Derived(6));
+
+        std::cout << "traverse the vector:\n";
+        for (Base &b : v)
+            std::cout << "\tI am a " << b.getName() << " with value " << b.getValue() << "\n";
+    }
+
     // Frankenobject -- composed of parts of multiple objects
     void vf_frankenobject(void)
     {
@@ -723,6 +771,8 @@ namespace Test7
         vf_vector_slicing();
         vf_vector_ref_wrapper();
 
+        vf_poly_vector();
+
         std::cout << "\nSlicing Frankenobject\n";
         vf_frankenobject();
     }
@@ -904,6 +954,9 @@ namespace Test8
  *
  * Set operator<< in Base class and call the virtual function to Derived class.
  * It will not implement operator<< for each Derived class.
+ *
+ * The same works for a Buffer(buffer.h): print(Buffer&) appends to memory,
+ * printAll() writes a whole container at once, Test 17 compares them.
  */
 
 namespace Test9
@@ -927,6 +980,17 @@ namespace Test9
             out << "Base";
             return out;
         }
+
+        friend Buffer& operator<<(Buffer &buf, const Base &b)
+        {
+            b.print(buf);
+            return buf;
+        }
+
+        virtual void print(Buffer &buf) const
+        {
+            buf << "Base";
+        }
     };
 
     class Derived : public Base
@@ -940,6 +1004,11 @@ namespace Test9
             out << "Derived";
             return out;
         }
+
+        virtual void print(Buffer &buf) const override
+        {
+            buf << "Derived";
+        }
     };
 
     void fn(void)
@@ -962,18 +1031,1516 @@ namespace Test9
         std::cout << "\n<< refrence base:\n";
         Base &bref = d;
         std::cout << bref << '\n';
+
+        // into a Buffer, one write
+        std::cout << "\n<< Buffer:\n";
+        Buffer buf;
+        buf << b << ", " << bref << '\n';
+        buf.writeTo(std::cout);
+
+        std::cout << "\nprintAll:\n";
+        std::vector<const Base*> objects = { &b, &d, &bref };
+        printAll(std::cout, objects, buf);
+        std::cout << '\n';
+    }
+}
+
+/*
+ * === Test 10: asynchronous IErrorLog ===
+ *
+ * writeError() latency at 1M messages/sec: message i is written at start + i us,
+ * the caller spins until then, like a busy server reporting errors.
+ *   SyncFileErrorLog: write(2) in writeError(), the caller waits for the kernel
+ *   FileErrorLog:     only copies into the queue, the writer thread batches
+ *                     by writev(2) and fsync(2)s every second(error_log.h)
+ *
+ * Reports percentiles of ns per writeError(), the rate reached and the
+ * messages dropped on a full queue.
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test10
+{
+    const int MESSAGES = 1000000;
+    const int RATE = 1000000;   // per second
+
+    // the simple way: every error is one write(2)
+    class SyncFileErrorLog : public IErrorLog
+    {
+    private:
+        int m_fd;
+
+    public:
+        SyncFileErrorLog() : m_fd(-1) { }
+        virtual ~SyncFileErrorLog() { closeLog(); }
+
+        virtual bool openLog(const char *filename)
+        {
+            m_fd = open(filename, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            return m_fd >= 0;
+        }
+
+        virtual bool closeLog()
+        {
+            if (m_fd < 0)
+                return false;
+            fsync(m_fd);
+            close(m_fd);
+            m_fd = -1;
+            return true;
+        }
+
+        virtual bool writeError(const char *errorMessage)
+        {
+            char line[AsyncErrorLog::MAX_MESSAGE];
+            size_t length = strlen(errorMessage);
+            if (length > sizeof(line) - 1)
+                length = sizeof(line) - 1;
+            memcpy(line, errorMessage, length);
+            line[length] = '\n';
+            return write(m_fd, line, length + 1) == static_cast<ssize_t>(length + 1);
+        }
+    };
+
+    // returns the dropped messages, or -1 if it can't tell
+    long bench(const char *name, IErrorLog &log, long (*dropped)(IErrorLog &))
+    {
+        typedef std::chrono::steady_clock clock;
+
+        std::string filename = std::string(P_tmpdir) + "/virtual_func_bench.log";
+        unlink(filename.c_str());
+        if (!log.openLog(filename.c_str())) {
+            std::cout << name << "cannot open " << filename << "\n";
+            return -1;
+        }
+
+        std::vector<int> samples(MESSAGES);
+        clock::time_point start = clock::now();
+        for (int i = 0; i < MESSAGES; ++i) {
+            clock::time_point due = start + std::chrono::nanoseconds(1000000000LL * i / RATE);
+            while (clock::now() < due)
+                ;
+
+            clock::time_point t0 = clock::now();
+            log.writeError("Tried to take square root of value less than 0");
+            clock::time_point t1 = clock::now();
+            samples[i] = static_cast<int>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        }
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        log.closeLog();
+        unlink(filename.c_str());
+
+        std::sort(samples.begin(), samples.end());
+        std::cout << name << "p50 " << samples[MESSAGES / 2]
+                  << ", p99 " << samples[MESSAGES / 100 * 99]
+                  << ", p99.9 " << samples[MESSAGES / 1000 * 999]
+                  << ", max " << samples[MESSAGES - 1] << " ns, "
+                  << MESSAGES / seconds * 1e-6 << " M/sec";
+        long n = dropped(log);
+        if (n >= 0)
+            std::cout << ", dropped " << n;
+        std::cout << "\n";
+        return n;
+    }
+
+    long noDrops(IErrorLog &) { return -1; }
+    long asyncDrops(IErrorLog &log) { return static_cast<AsyncErrorLog&>(log).dropped(); }
+
+    void fn(void)
+    {
+        std::cout << MESSAGES << " writeError() at " << RATE / 1000000 << "M/sec\n";
+
+        SyncFileErrorLog syncLog;
+        bench("SyncFileErrorLog : ", syncLog, &noDrops);
+
+        FileErrorLog asyncLog;
+        bench("FileErrorLog     : ", asyncLog, &asyncDrops);
+    }
+}
+
+/*
+ * === Test 11: type-partitioned collection, statically bound calls ===
+ *
+ * Test 1's report(Animal&) and Test 5's speak() go through the vtable of each
+ * object. Over a mixed collection the target changes from object to object,
+ * the indirect branch is mispredicted, and every object is a separate
+ * allocation.
+ *
+ * PolyCollection(poly_collection.h) stores each concrete type in its own
+ * std::vector. Benchmark: sum speak() of COUNT animals, Cat/Dog/Cow shuffled:
+ *   vector<Animal*> shuffled:  virtual call, unpredictable target
+ *   vector<Animal*> sorted:    virtual call, the same target for long runs,
+ *                              but the objects are still scattered in memory
+ *   forEachBase():             virtual call, contiguous by type
+ *   forEach():                 static call on Cat&/Dog&/Cow&, inlined(final)
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test11
+{
+    const int COUNT = 10000000;
+    const int ROUNDS = 5;
+
+    class Animal
+    {
+    protected:
+        int m_volume;
+
+    public:
+        Animal(int volume) : m_volume(volume) { }
+        virtual ~Animal() { }
+
+        virtual int speak() const = 0;
+    };
+
+    // final: a call through Cat& can be bound at compile time
+    class Cat final : public Animal
+    {
+    public:
+        Cat(int volume) : Animal(volume) { }
+        virtual int speak() const override { return m_volume * 3; }
+    };
+
+    class Dog final : public Animal
+    {
+    public:
+        Dog(int volume) : Animal(volume) { }
+        virtual int speak() const override { return m_volume + 7; }
+    };
+
+    class Cow final : public Animal
+    {
+    public:
+        Cow(int volume) : Animal(volume) { }
+        virtual int speak() const override { return m_volume ^ 5; }
+    };
+
+    typedef PolyCollection<Animal, Cat, Dog, Cow> Zoo;
+
+    void vf_collection(void)
+    {
+        Zoo zoo;
+        zoo.insert(Dog(1));
+        zoo.insert(Cat(2));
+        zoo.emplace<Cow>(3);
+        zoo.insert(Cat(4));
+
+        std::cout << zoo.size() << " animals, by type:";
+        zoo.forEach([](const Animal &a) { std::cout << " " << a.speak(); });
+        std::cout << "\n";
+    }
+
+    // the best of ROUNDS, ns per animal
+    template <class F>
+    double timeIt(F f)
+    {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            Timer t;
+            long sum = f();
+            double ns = t.elapsed() * 1e9 / COUNT;
+            doNotOptimize(sum);
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    long sumPointers(const std::vector<std::unique_ptr<Animal> > &animals)
+    {
+        long sum = 0;
+        for (const std::unique_ptr<Animal> &a : animals)
+            sum += a->speak();
+        return sum;
+    }
+
+    void vf_collection_bench(void)
+    {
+        // the same shuffled kinds for both containers
+        std::vector<int> kinds(COUNT);
+        for (int i = 0; i < COUNT; ++i)
+            kinds[i] = i % 3;
+        std::shuffle(kinds.begin(), kinds.end(), std::mt19937(42));
+
+        std::vector<std::unique_ptr<Animal> > animals;
+        animals.reserve(COUNT);
+        Zoo zoo;
+        zoo.reserve<Cat>(COUNT / 3 + 1);
+        zoo.reserve<Dog>(COUNT / 3 + 1);
+        zoo.reserve<Cow>(COUNT / 3 + 1);
+
+        for (int i = 0; i < COUNT; ++i) {
+            switch (kinds[i]) {
+            case 0: animals.emplace_back(new Cat(i)); zoo.emplace<Cat>(i); break;
+            case 1: animals.emplace_back(new Dog(i)); zoo.emplace<Dog>(i); break;
+            default: animals.emplace_back(new Cow(i)); zoo.emplace<Cow>(i); break;
+            }
+        }
+
+        std::cout << COUNT << " animals, ns per speak():\n";
+        std::cout << "vector<Animal*> shuffled : "
+                  << timeIt([&] { return sumPointers(animals); }) << "\n";
+
+        // the same objects, sorted by type
+        std::stable_sort(animals.begin(), animals.end(),
+                         [](const std::unique_ptr<Animal> &a, const std::unique_ptr<Animal> &b) {
+                             return typeid(*a).before(typeid(*b));
+                         });
+        std::cout << "vector<Animal*> sorted   : "
+                  << timeIt([&] { return sumPointers(animals); }) << "\n";
+
+        std::cout << "PolyCollection base      : " << timeIt([&] {
+            long sum = 0;
+            zoo.forEachBase([&sum](const Animal &a) { sum += a.speak(); });
+            return sum;
+        }) << "\n";
+
+        std::cout << "PolyCollection static    : " << timeIt([&] {
+            long sum = 0;
+            zoo.forEach([&sum](const auto &a) { sum += a.speak(); });
+            return sum;
+        }) << "\n";
+    }
+
+    void fn(void)
+    {
+        std::cout << "<<< PolyCollection >>>\n";
+        vf_collection();
+
+        std::cout << "\n<<< vector<Animal*> vs PolyCollection >>>\n";
+        vf_collection_bench();
+    }
+}
+
+/*
+ * === Test 12: PolyVector vs vector<unique_ptr<Base>> ===
+ *
+ * COUNT shapes of mixed types and sizes, created and iterated through Base&:
+ *   vector<unique_ptr<Shape>>: an allocation per shape, iteration follows a
+ *                              pointer to wherever the allocator put it
+ *   PolyVector<Shape>:         shapes inline in one buffer, moved when it grows
+ *
+ * A fresh heap hands out consecutive addresses, the pointers are almost as
+ * good as one buffer. A heap that has been in use puts them all over the
+ * place. Growing a PolyVector moves every shape, reserve() avoids it.
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test12
+{
+    const int COUNT = 1000000;
+    const int ROUNDS = 5;
+
+    class Shape
+    {
+    public:
+        virtual ~Shape() { }
+        virtual double area() const = 0;
+    };
+
+    class Circle : public Shape
+    {
+    private:
+        double m_radius;
+
+    public:
+        Circle(double radius) : m_radius(radius) { }
+        virtual double area() const override { return 3.14159265 * m_radius * m_radius; }
+    };
+
+    class Rect : public Shape
+    {
+    private:
+        double m_width;
+        double m_height;
+
+    public:
+        Rect(double width, double height) : m_width(width), m_height(height) { }
+        virtual double area() const override { return m_width * m_height; }
+    };
+
+    class Polygon : public Shape
+    {
+    private:
+        double m_x[4];
+        double m_y[4];
+
+    public:
+        Polygon(double size) : m_x{0, size, size, 0}, m_y{0, 0, size, size} { }
+
+        // shoelace formula
+        virtual double area() const override
+        {
+            double sum = 0;
+            for (int i = 0; i < 4; ++i)
+                sum += m_x[i] * m_y[(i + 1) % 4] - m_x[(i + 1) % 4] * m_y[i];
+            return sum / 2;
+        }
+    };
+
+    void create(std::vector<std::unique_ptr<Shape> > &shapes, const std::vector<int> &kinds)
+    {
+        shapes.reserve(COUNT);
+        for (int i = 0; i < COUNT; ++i) {
+            switch (kinds[i]) {
+            case 0: shapes.emplace_back(new Circle(i)); break;
+            case 1: shapes.emplace_back(new Rect(i, 2)); break;
+            default: shapes.emplace_back(new Polygon(i)); break;
+            }
+        }
+    }
+
+    void create(PolyVector<Shape> &shapes, const std::vector<int> &kinds)
+    {
+        for (int i = 0; i < COUNT; ++i) {
+            switch (kinds[i]) {
+            case 0: shapes.emplace_back<Circle>(i); break;
+            case 1: shapes.emplace_back<Rect>(i, 2); break;
+            default: shapes.emplace_back<Polygon>(i); break;
+            }
+        }
+    }
+
+    double area(const std::unique_ptr<Shape> &s) { return s->area(); }
+    double area(const Shape &s) { return s.area(); }
+
+    // ns per shape: create, iterate(the best of ROUNDS), destroy
+    template <class Container, class Prepare>
+    void bench(const char *name, const std::vector<int> &kinds, Prepare prepare)
+    {
+        Timer t;
+        Container *shapes = new Container;
+        prepare(*shapes);
+        create(*shapes, kinds);
+        double created = t.elapsed() * 1e9 / COUNT;
+
+        double iterated = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            t.reset();
+            double sum = 0;
+            for (auto &s : *shapes)
+                sum += area(s);
+            doNotOptimize(sum);
+            double ns = t.elapsed() * 1e9 / COUNT;
+            if (r == 0 || ns < iterated)
+                iterated = ns;
+        }
+
+        t.reset();
+        delete shapes;
+        double destroyed = t.elapsed() * 1e9 / COUNT;
+
+        std::cout << name << "create " << created << ", iterate " << iterated
+                  << ", destroy " << destroyed << " ns\n";
+    }
+
+    void fn(void)
+    {
+        typedef std::vector<std::unique_ptr<Shape> > PtrVector;
+
+        std::vector<int> kinds(COUNT);
+        std::mt19937 rng(42);
+        for (int i = 0; i < COUNT; ++i)
+            kinds[i] = static_cast<int>(rng() % 3);
+
+        std::cout << COUNT << " shapes, Circle/Rect/Polygon of " << sizeof(Circle) << "/"
+                  << sizeof(Rect) << "/" << sizeof(Polygon) << " bytes\n";
+
+        bench<PtrVector>("vector<unique_ptr>, fresh heap : ", kinds, [](PtrVector &) { });
+
+        // a heap that has been in use: the allocator hands out freed holes
+        // all over the place instead of consecutive addresses
+        std::vector<std::unique_ptr<char[]> > holes;
+        for (int i = 0; i < COUNT; ++i)
+            holes.emplace_back(new char[16 + 8 * (rng() % 8)]);
+        std::shuffle(holes.begin(), holes.end(), rng);
+        holes.resize(COUNT / 2);
+        bench<PtrVector>("vector<unique_ptr>, used heap  : ", kinds, [](PtrVector &) { });
+        holes.clear();
+
+        bench<PolyVector<Shape> >("PolyVector                     : ", kinds,
+                                  [](PolyVector<Shape> &) { });
+        bench<PolyVector<Shape> >("PolyVector, reserved           : ", kinds,
+                                  [](PolyVector<Shape> &v) { v.reserve(COUNT * (sizeof(Polygon) + 16)); });
+    }
+}
+
+/*
+ * === Test 13: isa/cast/dyn_cast vs dynamic_cast ===
+ *
+ * Test 8 checks getClassID() before a static_cast, by hand for every class,
+ * and a virtual call. casting.h makes it general: the base class stores the
+ * kind of the object, every class has a classof() comparing the kind with
+ * the range of kinds of itself and its derived classes.
+ *
+ * Benchmark: COUNT objects of a random level of a chain of Depth classes
+ * (Level<Depth, 0> <- Level<Depth, 1> <- ... <- Level<Depth, Depth>), cast
+ * down to level 1 and to the leaf, ns per cast, the best of ROUNDS.
+ * dynamic_cast gets slower the further the object's class is from the target.
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test13
+{
+    class Shape
+    {
+    public:
+        // depth-first order, a class and its derived classes are a range
+        enum ShapeKind
+        {
+            SK_CIRCLE,
+            SK_RECT,
+            SK_SQUARE,
+            SK_LAST_RECT = SK_SQUARE,
+        };
+
+    private:
+        const ShapeKind m_kind;
+
+    protected:
+        Shape(ShapeKind kind) : m_kind(kind) { }
+
+    public:
+        virtual ~Shape() { }
+
+        ShapeKind getKind() const { return m_kind; }
+        virtual double area() const = 0;
+    };
+
+    class Circle : public Shape
+    {
+    private:
+        double m_radius;
+
+    public:
+        Circle(double radius) : Shape(SK_CIRCLE), m_radius(radius) { }
+
+        double getRadius() const { return m_radius; }
+        virtual double area() const override { return 3.14159265 * m_radius * m_radius; }
+
+        static bool classof(const Shape *s) { return s->getKind() == SK_CIRCLE; }
+    };
+
+    class Rect : public Shape
+    {
+    protected:
+        double m_width;
+        double m_height;
+
+        Rect(ShapeKind kind, double width, double height)
+            : Shape(kind), m_width(width), m_height(height)
+        { }
+
+    public:
+        Rect(double width, double height) : Rect(SK_RECT, width, height) { }
+
+        double getWidth() const { return m_width; }
+        virtual double area() const override { return m_width * m_height; }
+
+        // Rect and Square
+        static bool classof(const Shape *s)
+        {
+            return s->getKind() >= SK_RECT && s->getKind() <= SK_LAST_RECT;
+        }
+    };
+
+    class Square : public Rect
+    {
+    public:
+        Square(double side) : Rect(SK_SQUARE, side, side) { }
+
+        static bool classof(const Shape *s) { return s->getKind() == SK_SQUARE; }
+    };
+
+    void vf_isa(void)
+    {
+        std::unique_ptr<Shape> shapes[] = {
+            std::unique_ptr<Shape>(new Circle(1)),
+            std::unique_ptr<Shape>(new Rect(2, 3)),
+            std::unique_ptr<Shape>(new Square(4)),
+        };
+
+        for (const std::unique_ptr<Shape> &s : shapes) {
+            std::cout << "kind " << s->getKind() << ": isa<Circle> " << isa<Circle>(*s)
+                      << ", isa<Rect> " << isa<Rect>(*s) << ", isa<Square> " << isa<Square>(*s);
+
+            if (const Circle *c = dyn_cast<Circle>(s.get()))
+                std::cout << ", a Circle of radius " << c->getRadius() << "\n";
+            else
+                std::cout << ", a Rect of width " << cast<Rect>(*s).getWidth() << "\n";
+        }
+    }
+
+    const int COUNT = 1000000;
+    const int ROUNDS = 5;
+
+    // a chain of classes, the kind of Level<Depth, N> is N
+    template <int Depth, int N>
+    class Level : public Level<Depth, N - 1>
+    {
+    protected:
+        Level(int kind) : Level<Depth, N - 1>(kind) { }
+
+    public:
+        Level() : Level<Depth, N - 1>(N) { }
+
+        // levels N to Depth derive from this one
+        static bool classof(const Level<Depth, 0> *obj)
+        {
+            return obj->getKind() >= N && obj->getKind() <= Depth;
+        }
+    };
+
+    template <int Depth>
+    class Level<Depth, 0>
+    {
+    private:
+        int m_kind;
+
+    protected:
+        Level(int kind) : m_kind(kind) { }
+
+    public:
+        Level() : m_kind(0) { }
+        virtual ~Level() { }
+
+        int getKind() const { return m_kind; }
+    };
+
+    // new Level<Depth, level>, level <= N
+    template <int Depth, int N>
+    struct Factory
+    {
+        static Level<Depth, 0>* create(int level)
+        {
+            return level == N ? new Level<Depth, N> : Factory<Depth, N - 1>::create(level);
+        }
+    };
+
+    template <int Depth>
+    struct Factory<Depth, 0>
+    {
+        static Level<Depth, 0>* create(int) { return new Level<Depth, 0>; }
+    };
+
+    // ns per call of f(object), the best of ROUNDS
+    template <class Root, class F>
+    double timeCasts(const std::vector<Root*> &objects, F f)
+    {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            Timer t;
+            int sum = 0;
+            for (Root *obj : objects)
+                sum += f(obj);
+            doNotOptimize(sum);
+            double ns = t.elapsed() * 1e9 / objects.size();
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    template <int Depth, int Target>
+    void benchTarget(const std::vector<Level<Depth, 0>*> &objects)
+    {
+        typedef Level<Depth, 0> Root;
+        typedef Level<Depth, Target> To;
+
+        double rtti = timeCasts(objects, [](Root *obj) {
+            To *t = dynamic_cast<To*>(obj);
+            return t ? t->getKind() : 0;
+        });
+        double kind = timeCasts(objects, [](Root *obj) {
+            To *t = dyn_cast<To>(obj);
+            return t ? t->getKind() : 0;
+        });
+        std::cout << "  to level " << Target << ": dynamic_cast " << rtti
+                  << ", dyn_cast " << kind << " ns\n";
+    }
+
+    template <int Depth>
+    void benchDepth(void)
+    {
+        std::vector<std::unique_ptr<Level<Depth, 0> > > owned;
+        std::vector<Level<Depth, 0>*> objects;
+        std::mt19937 rng(42);
+        for (int i = 0; i < COUNT; ++i) {
+            owned.emplace_back(Factory<Depth, Depth>::create(static_cast<int>(rng() % (Depth + 1))));
+            objects.push_back(owned.back().get());
+        }
+
+        std::cout << Depth << " level(s) below the root, objects of every level:\n";
+        benchTarget<Depth, 1>(objects);
+        if (Depth > 1)
+            benchTarget<Depth, Depth>(objects);
+    }
+
+    void fn(void)
+    {
+        vf_isa();
+
+        std::cout << "\n" << COUNT << " downcasts\n";
+        benchDepth<1>();
+        benchDepth<3>();
+        benchDepth<6>();
+    }
+}
+
+/*
+ * === Test 14: std::variant and std::visit for a closed hierarchy(C++17) ===
+ *
+ * Test 1's Animal has a fixed set of derived classes, Cat and Dog. The
+ * classes don't have to derive from anything, a std::variant<Cat, Dog> is
+ * either of them, by value:
+ *   - no vptr, no heap, a std::vector<variant> keeps them contiguous
+ *   - std::visit(f, v) calls f with the type v holds, f(Cat&) or f(Dog&),
+ *     a generic lambda covers all, a missing overload doesn't compile
+ *   - the size is the largest type plus the index of the type held
+ *
+ * Benchmark: COUNT objects of A, B, C and D(Test 1's chain) in random order,
+ * summing value() of each, ns per object, the best of ROUNDS:
+ *   virtual:  std::vector<std::unique_ptr<A> >, a virtual call per object
+ *   visit:    std::vector<std::variant<A, B, C, D> >, std::visit
+ *   switch:   std::vector<Tagged>, a struct with a type tag, switch on it
+ *
+ * NOTE:
+ *   - Adding a type changes the variant, every visit is compiled again, the
+ *     hierarchy has to be closed. Virtual functions let anyone add a class.
+ *   - Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test14
+{
+    struct Cat
+    {
+        std::string m_name;
+        const char* speak() const { return "Meow"; }
+    };
+
+    struct Dog
+    {
+        std::string m_name;
+        const char* speak() const { return "Woof"; }
+    };
+
+    typedef std::variant<Cat, Dog> Animal;
+
+    void vf_variant_animal(void)
+    {
+        std::vector<Animal> animals;
+        animals.push_back(Cat{"Mimi"});
+        animals.push_back(Dog{"Wangwang"});
+
+        for (const Animal &animal : animals) {
+            std::visit([](const auto &a) {
+                std::cout << a.m_name << " says " << a.speak() << '\n';
+            }, animal);
+        }
+
+        std::cout << "sizeof(Animal) " << sizeof(Animal) << ", sizeof(std::string) "
+                  << sizeof(std::string) << ", a Dog is held: " << std::holds_alternative<Dog>(animals[1])
+                  << '\n';
+    }
+
+    const int COUNT = 10000000;
+    const int ROUNDS = 5;
+
+    // Test 1's A <- B <- C <- D, virtual
+    namespace Virtual
+    {
+        class A
+        {
+        protected:
+            int m_x;
+
+        public:
+            A(int x) : m_x(x) { }
+            virtual ~A() { }
+            virtual int value() const { return m_x + 1; }
+        };
+
+        class B : public A
+        {
+        public:
+            B(int x) : A(x) { }
+            virtual int value() const override { return m_x * 2; }
+        };
+
+        class C : public B
+        {
+        public:
+            C(int x) : B(x) { }
+            virtual int value() const override { return m_x - 3; }
+        };
+
+        class D : public C
+        {
+        public:
+            D(int x) : C(x) { }
+            virtual int value() const override { return m_x ^ 5; }
+        };
+    }
+
+    // the same, by value
+    namespace Value
+    {
+        struct A { int m_x; int value() const { return m_x + 1; } };
+        struct B { int m_x; int value() const { return m_x * 2; } };
+        struct C { int m_x; int value() const { return m_x - 3; } };
+        struct D { int m_x; int value() const { return m_x ^ 5; } };
+
+        typedef std::variant<A, B, C, D> Object;
+    }
+
+    // the same, a tag
+    struct Tagged
+    {
+        enum Kind { KIND_A, KIND_B, KIND_C, KIND_D };
+
+        Kind m_kind;
+        int m_x;
+
+        int value() const
+        {
+            switch (m_kind) {
+            case KIND_A: return m_x + 1;
+            case KIND_B: return m_x * 2;
+            case KIND_C: return m_x - 3;
+            case KIND_D: return m_x ^ 5;
+            }
+            return 0;
+        }
+    };
+
+    // ns per object of f(), returning the sum, the best of ROUNDS
+    template <class F>
+    double timeSum(F f)
+    {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            Timer t;
+            long sum = f();
+            doNotOptimize(sum);
+            double ns = t.elapsed() * 1e9 / COUNT;
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    void fn(void)
+    {
+        vf_variant_animal();
+
+        std::vector<int> kinds(COUNT);
+        std::mt19937 rng(42);
+        for (int i = 0; i < COUNT; ++i)
+            kinds[i] = static_cast<int>(rng() % 4);
+
+        std::cout << "\n" << COUNT << " objects of A, B, C and D\n";
+        {
+            std::vector<std::unique_ptr<Virtual::A> > objects;
+            objects.reserve(COUNT);
+            for (int i = 0; i < COUNT; ++i) {
+                switch (kinds[i]) {
+                case 0: objects.emplace_back(new Virtual::A(i)); break;
+                case 1: objects.emplace_back(new Virtual::B(i)); break;
+                case 2: objects.emplace_back(new Virtual::C(i)); break;
+                default: objects.emplace_back(new Virtual::D(i)); break;
+                }
+            }
+            double ns = timeSum([&objects] {
+                long sum = 0;
+                for (const std::unique_ptr<Virtual::A> &obj : objects)
+                    sum += obj->value();
+                return sum;
+            });
+            std::cout << "virtual: " << ns << " ns, " << sizeof(Virtual::A)
+                      << " bytes per object on the heap, and a pointer\n";
+        }
+        {
+            std::vector<Value::Object> objects;
+            objects.reserve(COUNT);
+            for (int i = 0; i < COUNT; ++i) {
+                switch (kinds[i]) {
+                case 0: objects.push_back(Value::A{i}); break;
+                case 1: objects.push_back(Value::B{i}); break;
+                case 2: objects.push_back(Value::C{i}); break;
+                default: objects.push_back(Value::D{i}); break;
+                }
+            }
+            double ns = timeSum([&objects] {
+                long sum = 0;
+                for (const Value::Object &obj : objects)
+                    sum += std::visit([](const auto &o) { return o.value(); }, obj);
+                return sum;
+            });
+            std::cout << "visit:   " << ns << " ns, " << sizeof(Value::Object) << " bytes per object\n";
+        }
+        {
+            std::vector<Tagged> objects;
+            objects.reserve(COUNT);
+            for (int i = 0; i < COUNT; ++i)
+                objects.push_back(Tagged{static_cast<Tagged::Kind>(kinds[i]), i});
+            double ns = timeSum([&objects] {
+                long sum = 0;
+                for (const Tagged &obj : objects)
+                    sum += obj.value();
+                return sum;
+            });
+            std::cout << "switch:  " << ns << " ns, " << sizeof(Tagged) << " bytes per object\n";
+        }
+    }
+}
+
+/*
+ * === Test 15: CRTP, Test 1's A <- B <- C <- D without virtual ===
+ *
+ * crtp.h: Named<Derived> is the interface, getName() and getValue() call
+ * the most derived name() and value() through a static_cast, every value()
+ * adds its step to the one of its base class.
+ *
+ * Benchmark: getValue(i) summed for i in [0, COUNT), ns per call, the best of
+ * ROUNDS:
+ *   virtual: through A&, the object is picked at run time, an indirect call
+ *            per element, the chain inside can't be inlined into the loop
+ *   CRTP:    through Named<D<> >&, the whole chain inlines into the loop, and
+ *            the loop vectorizes
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test15
+{
+    // the interface
+    template <class Derived>
+    class Named : public Crtp<Derived>
+    {
+    public:
+        const char* getName() const { return this->self().name(); }
+        int getValue(int x) const { return this->self().value(x); }
+    };
+
+    template <class Self = void>
+    class A : public Named<MostDerived<Self, A<> > >
+    {
+    public:
+        const char* name() const { return "A"; }
+        int value(int x) const { return x + 1; }
+    };
+
+    template <class Self = void>
+    class B : public A<MostDerived<Self, B<> > >
+    {
+    public:
+        const char* name() const { return "B"; }
+        int value(int x) const { return A<MostDerived<Self, B<> > >::value(x) * 2; }
+    };
+
+    template <class Self = void>
+    class C : public B<MostDerived<Self, C<> > >
+    {
+    public:
+        const char* name() const { return "C"; }
+        int value(int x) const { return B<MostDerived<Self, C<> > >::value(x) - 3; }
+    };
+
+    template <class Self = void>
+    class D : public C<MostDerived<Self, D<> > >
+    {
+    public:
+        const char* name() const { return "D"; }
+        int value(int x) const { return C<MostDerived<Self, D<> > >::value(x) ^ 5; }
+    };
+
+    // the same chain, virtual
+    class VA
+    {
+    public:
+        virtual ~VA() { }
+        virtual const char* getName() const { return "A"; }
+        virtual int getValue(int x) const { return x + 1; }
+    };
+
+    class VB : public VA
+    {
+    public:
+        virtual const char* getName() const override { return "B"; }
+        virtual int getValue(int x) const override { return VA::getValue(x) * 2; }
+    };
+
+    class VC : public VB
+    {
+    public:
+        virtual const char* getName() const override { return "C"; }
+        virtual int getValue(int x) const override { return VB::getValue(x) - 3; }
+    };
+
+    class VD : public VC
+    {
+    public:
+        virtual const char* getName() const override { return "D"; }
+        virtual int getValue(int x) const override { return VC::getValue(x) ^ 5; }
+    };
+
+    // any Named, the type is a template parameter
+    template <class T>
+    void report(const Named<T> &obj)
+    {
+        std::cout << obj.getName() << ": getValue(10) = " << obj.getValue(10) << '\n';
+    }
+
+    void vf_crtp(void)
+    {
+        A<> a;
+        B<> b;
+        C<> c;
+        D<> d;
+        report(a);
+        report(b);
+        report(c);
+        report(d);
+
+        std::cout << "sizeof(D<>) " << sizeof(D<>) << ", sizeof(VD) " << sizeof(VD) << '\n';
+    }
+
+    const int COUNT = 10000000;
+    const int ROUNDS = 5;
+
+    template <class F>
+    double timeCalls(F f)
+    {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            Timer t;
+            long sum = 0;
+            for (int i = 0; i < COUNT; ++i)
+                sum += f(i);
+            doNotOptimize(sum);
+            double ns = t.elapsed() * 1e9 / COUNT;
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    template <class T>
+    double timeCrtp(const Named<T> &obj)
+    {
+        return timeCalls([&obj](int i) { return obj.getValue(i); });
+    }
+
+    VA* makeVirtual(int kind)
+    {
+        switch (kind) {
+        case 0: return new VA;
+        case 1: return new VB;
+        case 2: return new VC;
+        default: return new VD;
+        }
+    }
+
+    void fn(void)
+    {
+        vf_crtp();
+
+        // known at run time only, the compiler can't devirtualize
+        volatile int kind = 3;
+        std::unique_ptr<VA> v(makeVirtual(kind));
+        const VA &obj = *v;
+
+        D<> d;
+        std::cout << "\n" << COUNT << " calls of " << obj.getName() << "::getValue()\n";
+        std::cout << "virtual: " << timeCalls([&obj](int i) { return obj.getValue(i); }) << " ns\n";
+        std::cout << "CRTP:    " << timeCrtp(d) << " ns\n";
+    }
+}
+
+/*
+ * === Test 16: entity-component store instead of the Animal classes ===
+ *
+ * Test 1's Animal keeps m_name and its behaviour in every object, the
+ * objects are on the heap with a vptr each. ecs.h keeps the same data as
+ * components, one array per type, and the behaviour as systems:
+ *   Name, Sound: what Test 1 prints
+ *   Hunger, Motion: what the update loop changes
+ *
+ * Benchmark: COUNT Cats and Dogs updated ROUNDS times(the best is shown),
+ * ns per animal:
+ *   OO:       std::vector<std::unique_ptr<Animal> >, virtual update()
+ *   ECS:      each<Hunger, Motion>(), names are never loaded
+ *   parallel: parallelEach<Hunger, Motion>() on hardware_concurrency threads
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test16
+{
+    struct Name { std::string m_name; };
+    struct Sound { const char *m_sound; };
+    struct Hunger { float m_value; float m_rate; };
+    struct Motion { float m_x; float m_speed; };
+
+    void vf_ecs_animal(void)
+    {
+        World world;
+        Entity cat = world.create(Name{"Mimi"}, Sound{"Meow"}, Hunger{0, 1}, Motion{0, 2});
+        Entity dog = world.create(Name{"Wangwang"}, Sound{"Woof"}, Hunger{0, 2}, Motion{0, 5});
+
+        world.each<Name, Sound>([](Name &n, Sound &s) {
+            std::cout << n.m_name << " says " << s.m_sound << '\n';
+        });
+
+        std::cout << "Mimi falls asleep, Motion removed\n";
+        world.remove<Motion>(cat);
+
+        auto update = [](Hunger &h, Motion &m) {
+            h.m_value += h.m_rate;
+            m.m_x += m.m_speed;
+        };
+        world.each<Hunger, Motion>(update);
+        world.each<Hunger, Motion>(update);
+
+        world.each<Name, Hunger>([](Name &n, Hunger &h) {
+            std::cout << n.m_name << " hunger " << h.m_value << '\n';
+        });
+        std::cout << "Wangwang at " << world.get<Motion>(dog)->m_x << ", Mimi has Motion: "
+                  << (world.get<Motion>(cat) != nullptr) << ", archetypes " << world.archetypes() << '\n';
+
+        world.destroy(cat);
+        std::cout << "Mimi destroyed, alive " << world.alive(cat) << ", entities " << world.size() << '\n';
+    }
+
+    const int COUNT = 1000000;
+    const int ROUNDS = 5;
+    const float DT = 0.016f;
+
+    // the OO version
+    class Animal
+    {
+    protected:
+        std::string m_name;
+        float m_hunger;
+        float m_x;
+        float m_speed;
+
+        Animal(std::string name, float speed) : m_name(name), m_hunger(0), m_x(0), m_speed(speed) { }
+
+    public:
+        virtual ~Animal() { }
+        virtual const char* speak() const = 0;
+        virtual void update(float dt) = 0;
+    };
+
+    class Cat : public Animal
+    {
+    public:
+        Cat(std::string name, float speed) : Animal(name, speed) { }
+
+        virtual const char* speak() const override { return "Meow"; }
+        virtual void update(float dt) override
+        {
+            m_hunger += 1.0f * dt;
+            m_x += m_speed * dt;
+        }
+    };
+
+    class Dog : public Animal
+    {
+    public:
+        Dog(std::string name, float speed) : Animal(name, speed) { }
+
+        virtual const char* speak() const override { return "Woof"; }
+        virtual void update(float dt) override
+        {
+            m_hunger += 2.0f * dt;
+            m_x += m_speed * dt;
+        }
+    };
+
+    template <class F>
+    double timeUpdates(F f)
+    {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            Timer t;
+            f();
+            clobberMemory();
+            double ns = t.elapsed() * 1e9 / COUNT;
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    void fn(void)
+    {
+        vf_ecs_animal();
+
+        std::vector<int> kinds(COUNT);
+        std::mt19937 rng(42);
+        for (int i = 0; i < COUNT; ++i)
+            kinds[i] = static_cast<int>(rng() % 2);
+
+        std::cout << "\n" << COUNT << " animals\n";
+        {
+            std::vector<std::unique_ptr<Animal> > animals;
+            animals.reserve(COUNT);
+            for (int i = 0; i < COUNT; ++i) {
+                if (kinds[i] == 0)
+                    animals.emplace_back(new Cat("cat " + std::to_string(i), 2));
+                else
+                    animals.emplace_back(new Dog("dog " + std::to_string(i), 5));
+            }
+            double ns = timeUpdates([&animals] {
+                for (const std::unique_ptr<Animal> &a : animals)
+                    a->update(DT);
+            });
+            std::cout << "OO       : " << ns << " ns, " << sizeof(Cat) << " bytes per animal\n";
+        }
+        {
+            World world;
+            for (int i = 0; i < COUNT; ++i) {
+                if (kinds[i] == 0)
+                    world.create(Name{"cat " + std::to_string(i)}, Sound{"Meow"}, Hunger{0, 1}, Motion{0, 2});
+                else
+                    world.create(Name{"dog " + std::to_string(i)}, Sound{"Woof"}, Hunger{0, 2}, Motion{0, 5});
+            }
+            auto update = [](Hunger &h, Motion &m) {
+                h.m_value += h.m_rate * DT;
+                m.m_x += m.m_speed * DT;
+            };
+
+            double ns = timeUpdates([&world, &update] { world.each<Hunger, Motion>(update); });
+            std::cout << "ECS      : " << ns << " ns, " << sizeof(Hunger) + sizeof(Motion)
+                      << " bytes per animal loaded\n";
+
+            int threads = std::max(1u, std::thread::hardware_concurrency());
+            ns = timeUpdates([&world, &update, threads] {
+                world.parallelEach<Hunger, Motion>(update, threads);
+            });
+            std::cout << "parallel : " << ns << " ns, " << threads << " thread(s)\n";
+        }
+    }
+}
+
+/*
+ * === Test 17: operator<< to std::ostream vs print(Buffer&) ===
+ *
+ * COUNT Items and Orders(an Item with a quantity) printed through Item&,
+ * one line each, to /dev/null, ns per object:
+ *   ostream: out << item, every << goes through the stream's sentry and,
+ *            for numbers, the locale's num_put
+ *   Buffer:  printAll(), print(Buffer&) appends, one write per FLUSH_BYTES
+ *
+ * NOTE: build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test17
+{
+    const int COUNT = 10000000;
+
+    class Item
+    {
+    protected:
+        int m_id;
+
+    public:
+        Item(int id) : m_id(id) { }
+        virtual ~Item() { }
+
+        friend std::ostream& operator<<(std::ostream &out, const Item &item) { return item.print(out); }
+        friend Buffer& operator<<(Buffer &buf, const Item &item)
+        {
+            item.print(buf);
+            return buf;
+        }
+
+        virtual std::ostream& print(std::ostream &out) const
+        {
+            return out << "item " << m_id << '\n';
+        }
+
+        virtual void print(Buffer &buf) const
+        {
+            buf << "item " << m_id << '\n';
+        }
+    };
+
+    class Order : public Item
+    {
+    private:
+        long m_quantity;
+
+    public:
+        Order(int id, long quantity) : Item(id), m_quantity(quantity) { }
+
+        virtual std::ostream& print(std::ostream &out) const override
+        {
+            return out << "order " << m_id << " x " << m_quantity << '\n';
+        }
+
+        virtual void print(Buffer &buf) const override
+        {
+            buf << "order " << m_id << " x " << m_quantity << '\n';
+        }
+    };
+
+    void fn(void)
+    {
+        std::vector<std::unique_ptr<Item> > objects;
+        objects.reserve(COUNT);
+        for (int i = 0; i < COUNT; ++i) {
+            if (i % 2)
+                objects.emplace_back(new Order(i, i % 1000));
+            else
+                objects.emplace_back(new Item(i));
+        }
+
+        std::ofstream out("/dev/null");
+        std::cout << COUNT << " objects\n";
+
+        Timer t;
+        for (const std::unique_ptr<Item> &item : objects)
+            out << *item;
+        out.flush();
+        std::cout << "ostream: " << t.elapsed() * 1e9 / COUNT << " ns\n";
+
+        Buffer buf;
+        t.reset();
+        printAll(out, objects, buf);
+        out.flush();
+        std::cout << "Buffer:  " << t.elapsed() * 1e9 / COUNT << " ns\n";
+
+        // the same bytes
+        std::ostringstream a;
+        for (int i = 0; i < 3; ++i)
+            a << *objects[i];
+        buf.clear();
+        for (int i = 0; i < 3; ++i)
+            buf << *objects[i];
+        std::cout << "same output: " << (a.str() == buf.str()) << '\n';
+    }
+}
+
+/*
+ * === Test 18: the cost of a virtual base, and composing without one ===
+ *
+ * Test 6's Copier has one PoweredDevice through virtual inheritance. A
+ * Scanner member function can't know where PoweredDevice is, it depends on
+ * the most derived class, so every access reads the vptr, then the offset
+ * of the virtual base in the vtable, then the member.
+ *
+ * Mixins compose at compile time instead: ScannerMixin<Base> derives from
+ * whatever it's given, the chain is a single line of classes,
+ *
+ *   Copier -> PrinterMixin<ScannerMixin<PoweredDevice> >
+ *          -> ScannerMixin<PoweredDevice> -> PoweredDevice
+ *
+ * one PoweredDevice at a fixed offset, no vptr. A standalone scanner is a
+ * ScannerMixin<PoweredDevice> too, code taking one works for both.
+ *
+ * Benchmark: scan() on COUNT devices, half of them Copiers, through
+ * Scanner*, ns per call, the best of ROUNDS.
+ *
+ * NOTE:
+ *   - A PrinterMixin<PoweredDevice> and the Copier's printer part are
+ *     different types, code taking "any printer" becomes a template.
+ *   - Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+namespace Test18
+{
+    const int COUNT = 1000000;
+    const int ROUNDS = 5;
+
+    // Test 6 with data, no printing
+    namespace Virtual
+    {
+        class PoweredDevice
+        {
+        protected:
+            int m_power;
+            long m_energy;
+
+        public:
+            PoweredDevice(int power) : m_power(power), m_energy(0) { }
+            long getEnergy() const { return m_energy; }
+        };
+
+        class Scanner : virtual public PoweredDevice
+        {
+        protected:
+            int m_dpi;
+
+        public:
+            Scanner(int dpi, int power) : PoweredDevice(power), m_dpi(dpi) { }
+            void scan() { m_energy += m_power * m_dpi; }
+        };
+
+        class Printer : virtual public PoweredDevice
+        {
+        protected:
+            int m_speed;
+
+        public:
+            Printer(int speed, int power) : PoweredDevice(power), m_speed(speed) { }
+            void print() { m_energy += m_power * m_speed; }
+        };
+
+        class Copier : public Scanner, public Printer
+        {
+        public:
+            Copier(int dpi, int speed, int power)
+                : PoweredDevice(power), Scanner(dpi, power), Printer(speed, power)
+            { }
+        };
+    }
+
+    // composed at compile time
+    namespace Mixin
+    {
+        class PoweredDevice
+        {
+        protected:
+            int m_power;
+            long m_energy;
+
+        public:
+            PoweredDevice(int power) : m_power(power), m_energy(0) { }
+            long getEnergy() const { return m_energy; }
+        };
+
+        template <class Base>
+        class ScannerMixin : public Base
+        {
+        protected:
+            int m_dpi;
+
+        public:
+            template <class... Args>
+            ScannerMixin(int dpi, Args&&... args) : Base(std::forward<Args>(args)...), m_dpi(dpi) { }
+
+            void scan() { this->m_energy += this->m_power * m_dpi; }
+        };
+
+        template <class Base>
+        class PrinterMixin : public Base
+        {
+        protected:
+            int m_speed;
+
+        public:
+            template <class... Args>
+            PrinterMixin(int speed, Args&&... args) : Base(std::forward<Args>(args)...), m_speed(speed) { }
+
+            void print() { this->m_energy += this->m_power * m_speed; }
+        };
+
+        typedef ScannerMixin<PoweredDevice> Scanner;
+        typedef PrinterMixin<PoweredDevice> Printer;
+
+        class Copier : public PrinterMixin<Scanner>
+        {
+        public:
+            Copier(int dpi, int speed, int power) : PrinterMixin<Scanner>(speed, dpi, power) { }
+        };
+    }
+
+    // offset of the Base subobject in obj
+    template <class Base, class T>
+    long offsetOf(const T &obj)
+    {
+        return reinterpret_cast<const char*>(static_cast<const Base*>(&obj))
+            - reinterpret_cast<const char*>(&obj);
+    }
+
+    // CopierPrinter: the printer part of a Copier
+    template <class PoweredDevice, class Scanner, class Printer, class Copier, class CopierPrinter>
+    void reportLayout(const char *name)
+    {
+        Scanner scanner(300, 10);
+        Printer printer(20, 10);
+        Copier copier(300, 20, 10);
+
+        std::cout << name << '\n';
+        std::cout << "  sizeof: PoweredDevice " << sizeof(PoweredDevice) << ", Scanner "
+                  << sizeof(Scanner) << ", Printer " << sizeof(Printer) << ", Copier "
+                  << sizeof(Copier) << '\n';
+        std::cout << "  PoweredDevice in a Scanner at " << offsetOf<PoweredDevice>(scanner)
+                  << ", in a Printer at " << offsetOf<PoweredDevice>(printer) << '\n';
+        std::cout << "  in a Copier: Scanner at " << offsetOf<Scanner>(copier)
+                  << ", Printer at " << offsetOf<CopierPrinter>(copier)
+                  << ", PoweredDevice at " << offsetOf<PoweredDevice>(copier) << '\n';
+    }
+
+    // scan() through Scanner*, ns per call
+    template <class Scanner>
+    double timeScans(const std::vector<Scanner*> &scanners)
+    {
+        double best = 0;
+        for (int r = 0; r < ROUNDS; ++r) {
+            Timer t;
+            for (Scanner *s : scanners)
+                s->scan();
+            clobberMemory();
+            double ns = t.elapsed() * 1e9 / scanners.size();
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        return best;
+    }
+
+    // COUNT devices, every other one a Copier
+    template <class Scanner, class Copier>
+    double bench(void)
+    {
+        std::vector<Scanner> scanners;
+        std::vector<Copier> copiers;
+        scanners.reserve(COUNT / 2);
+        copiers.reserve(COUNT / 2);
+        std::vector<Scanner*> all;
+        for (int i = 0; i < COUNT / 2; ++i) {
+            scanners.push_back(Scanner(300, 10));
+            copiers.push_back(Copier(600, 20, 15));
+            all.push_back(&scanners.back());
+            all.push_back(&copiers.back());
+        }
+
+        double ns = timeScans(all);
+        doNotOptimize(all[1]->getEnergy());
+        return ns;
+    }
+
+    void fn(void)
+    {
+        reportLayout<Virtual::PoweredDevice, Virtual::Scanner, Virtual::Printer, Virtual::Copier,
+                     Virtual::Printer>("virtual base:");
+        reportLayout<Mixin::PoweredDevice, Mixin::Scanner, Mixin::Printer, Mixin::Copier,
+                     Mixin::PrinterMixin<Mixin::Scanner> >("mixin:");
+
+        std::cout << "\n" << COUNT << " scan() through Scanner*\n";
+        std::cout << "virtual base: " << bench<Virtual::Scanner, Virtual::Copier>() << " ns\n";
+        std::cout << "mixin:        " << bench<Mixin::Scanner, Mixin::Copier>() << " ns\n";
     }
 }
 
-int main()
+REGISTER_TEST(1, "virtual function basis");
+REGISTER_TEST(2, "override, final and covariant specifier");
+REGISTER_TEST(3, "destructor function");
+//REGISTER_TEST(4, "virutal table, compiling only for now");
+REGISTER_TEST(5, "pure virtual function and abstract base class");
+REGISTER_TEST(6, "virtual base class");
+REGISTER_TEST(7, "object slicing");
+REGISTER_TEST(8, "dynamic cast");
+REGISTER_TEST(9, "override << operatior");
+REGISTER_TEST(10, "asynchronous IErrorLog");
+REGISTER_TEST(11, "type-partitioned collection, statically bound calls");
+REGISTER_TEST(12, "PolyVector vs vector<unique_ptr<Base>>");
+REGISTER_TEST(13, "isa/cast/dyn_cast vs dynamic_cast");
+REGISTER_TEST(14, "std::variant/visit vs virtual vs switch");
+REGISTER_TEST(15, "CRTP, static polymorphism");
+REGISTER_TEST(16, "entity-component store vs OO Animal");
+REGISTER_TEST(17, "operator<< to ostream vs print(Buffer&)");
+REGISTER_TEST(18, "virtual base cost and mixin composition");
+
+int main(int argc, char *argv[])
 {
-    run(1, &(Test1::fn)); // virtual function basis
-    run(2, &(Test2::fn)); // override, final and covariant specifier
-    run(3, &(Test3::fn)); // destructor function
-    //run(4, &(Test4::fn)); // virutal table, compiling only for now
-    run(5, &(Test5::fn)); // pure virtual function and abstract base class
-    run(6, &(Test6::fn)); // virtual base class
-    run(7, &(Test7::fn)); // object slicing
-    run(8, &(Test8::fn)); // dynamic cast
-    run(9, &(Test9::fn)); // override << operatior
+    return runTests(argc, argv);
 }
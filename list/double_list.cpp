@@ -1,4 +1,13 @@
 #include <iostream>
+#include <type_traits>
+#include "logger.h"
+
+// cmake -DLIST_TRACE=ON: spans of the list operations, see basic/trace.h
+#ifdef LIST_TRACE
+#include "trace.h"
+#else
+#define TRACE_SCOPE(name)
+#endif
 
 class Node
 {
@@ -34,6 +43,15 @@ public:
         head->prev = head;
     }
     ~DoubleList();
+
+    // the list owns its nodes, a shallow copy would delete them twice
+    DoubleList(const DoubleList &) = delete;
+    DoubleList& operator=(const DoubleList &) = delete;
+
+    // moving only steals the head, it never allocates
+    DoubleList(DoubleList &&l) noexcept : head(l.head) { l.head = nullptr; }
+    DoubleList& operator=(DoubleList &&l) noexcept;
+
     bool isEmpty();
     void insertEntry(Node *entry);
     void insertEntry(int index);
@@ -68,6 +86,7 @@ void DoubleList::list_delete(Node *prev, Node *entry)
 
 void DoubleList::cleanList(void)
 {
+    TRACE_SCOPE("DoubleList::cleanList");
     if (isEmpty())
         return;
 
@@ -83,12 +102,34 @@ void DoubleList::cleanList(void)
 
 DoubleList::~DoubleList()
 {
+    if (head == nullptr) // moved-from
+        return;
+
     cleanList();
     head->next = nullptr;
     head->prev = nullptr;
     delete head;
 }
 
+DoubleList& DoubleList::operator=(DoubleList &&l) noexcept
+{
+    if (&l == this)
+        return *this;
+
+    if (head != nullptr) {
+        cleanList();
+        delete head;
+    }
+    head = l.head;
+    l.head = nullptr;
+    return *this;
+}
+
+static_assert(std::is_nothrow_move_constructible<DoubleList>::value,
+              "DoubleList move constructor must be noexcept");
+static_assert(std::is_nothrow_move_assignable<DoubleList>::value,
+              "DoubleList move assignment must be noexcept");
+
 bool DoubleList::isEmpty()
 {
     return (head->next == head);
@@ -106,12 +147,14 @@ void DoubleList::insertEntry(Node *entry)
 
 void DoubleList::insertEntry(int index)
 {
+    TRACE_SCOPE("DoubleList::insertEntry");
     Node *e = new Node(index);
     list_add(head, e);
 }
 
 void DoubleList::removeEntry(int index)
 {
+    TRACE_SCOPE("DoubleList::removeEntry");
     Node *prev = head;
     Node *cur = head->next;
 
@@ -125,12 +168,14 @@ void DoubleList::removeEntry(int index)
     }
 
     if (isEnd(cur)) {
-        std::cout << "Cannot find index " << index << "\n";
+        LOG_WARN("Cannot find index ", index);
+        Logger::flush();    // before the caller prints anything else
     }
 }
 
 void DoubleList::traverseList(void)
 {
+    TRACE_SCOPE("DoubleList::traverseList");
     std::cout << "head<-> ";
 
     Node *each = head->next;
@@ -1,4 +1,13 @@
 #include <iostream>
+#include <type_traits>
+#include "logger.h"
+
+// cmake -DLIST_TRACE=ON: spans of the list operations, see basic/trace.h
+#ifdef LIST_TRACE
+#include "trace.h"
+#else
+#define TRACE_SCOPE(name)
+#endif
 
 class Node
 {
@@ -29,6 +38,15 @@ private:
 public:
     SingleList() : head(new Node) { }
     ~SingleList();
+
+    // the list owns its nodes, a shallow copy would delete them twice
+    SingleList(const SingleList &) = delete;
+    SingleList& operator=(const SingleList &) = delete;
+
+    // moving only steals the head, it never allocates
+    SingleList(SingleList &&l) noexcept : head(l.head) { l.head = nullptr; }
+    SingleList& operator=(SingleList &&l) noexcept;
+
     bool isEmpty();
     void insertEntry(Node *entry);
     void insertEntry(int index);
@@ -58,6 +76,7 @@ bool SingleList::isEnd(Node *entry)
 
 void SingleList::cleanList(void)
 {
+    TRACE_SCOPE("SingleList::cleanList");
     if (isEmpty())
         return;
 
@@ -73,11 +92,33 @@ void SingleList::cleanList(void)
 
 SingleList::~SingleList()
 {
+    if (head == nullptr) // moved-from
+        return;
+
     cleanList();
     head->next = nullptr;
     delete head;
 }
 
+SingleList& SingleList::operator=(SingleList &&l) noexcept
+{
+    if (&l == this)
+        return *this;
+
+    if (head != nullptr) {
+        cleanList();
+        delete head;
+    }
+    head = l.head;
+    l.head = nullptr;
+    return *this;
+}
+
+static_assert(std::is_nothrow_move_constructible<SingleList>::value,
+              "SingleList move constructor must be noexcept");
+static_assert(std::is_nothrow_move_assignable<SingleList>::value,
+              "SingleList move assignment must be noexcept");
+
 bool SingleList::isEmpty()
 {
     return (head->next == nullptr);
@@ -90,12 +131,14 @@ void SingleList::insertEntry(Node *entry)
 
 void SingleList::insertEntry(int index)
 {
+    TRACE_SCOPE("SingleList::insertEntry");
     Node *e = new Node(index);
     list_add(head, e);
 }
 
 void SingleList::removeEntry(int index)
 {
+    TRACE_SCOPE("SingleList::removeEntry");
     Node *prev = head;
     Node *cur = head->next;
 
@@ -109,12 +152,14 @@ void SingleList::removeEntry(int index)
     }
 
     if (isEnd(cur)) {
-        std::cout << "Cannot find index " << index << "\n";
+        LOG_WARN("Cannot find index ", index);
+        Logger::flush();    // before the caller prints anything else
     }
 }
 
 void SingleList::traverseList(void)
 {
+    TRACE_SCOPE("SingleList::traverseList");
     std::cout << "head-> ";
 
     Node *each = head->next;